@@ -0,0 +1,101 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef __INET_BINARYRESULTFORMAT_H
+#define __INET_BINARYRESULTFORMAT_H
+
+#include <cstdint>
+#include <cstring>
+
+namespace inet {
+
+/**
+ * On-disk layout of the files written by BinaryResultRecorder and read by
+ * the qrecdump tool. All integers are little endian.
+ *
+ *   FileHeader
+ *   block 0, block 1, ...      blockSize bytes each
+ *   stream table               numStreams entries, at streamTableOffset
+ *
+ * A block is a BlockHeader followed by count Records, zero padded to
+ * blockSize. Each record's time is the previous record's time (the block's
+ * startTime for the first) plus its delta, in simulation time ticks. When
+ * the gap to the previous record does not fit into the 32 bit delta (4.3ms
+ * at the default ps resolution), a TIME_RECORD is written before the
+ * record: it carries no value, but sets the current time to the absolute
+ * time in its value field, and the record follows with delta 0. Fixed-size
+ * blocks let a reader binary search the block start times and read only
+ * the blocks of a time window.
+ *
+ * A stream table entry is the stream id, the lengths of the module path
+ * and the result name (uint16_t each), then the two strings without
+ * terminators. The table is written when the file is closed; a file whose
+ * run crashed has streamTableOffset 0, but its blocks are still readable.
+ */
+namespace binrec {
+
+const char FILE_MAGIC[8] = { 'I', 'N', 'E', 'T', 'Q', 'R', 'E', 'C' };
+const uint32_t VERSION = 2;          // 1 had no TIME_RECORDs
+const uint32_t BLOCK_MAGIC = 0x4b4c4251;   // "QBLK"
+const uint32_t DEFAULT_BLOCK_SIZE = 65536;
+const uint16_t TIME_RECORD = 1;      // Record flag
+
+struct FileHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t blockSize;
+    int32_t scaleExp;           // SimTime::getScaleExp()
+    uint32_t numStreams;
+    uint64_t streamTableOffset;
+};
+
+struct BlockHeader
+{
+    uint32_t magic;
+    uint32_t count;
+    int64_t startTime;          // ticks
+};
+
+struct Record
+{
+    uint16_t stream;
+    uint16_t flags;
+    uint32_t delta;             // ticks since the previous record
+    double value;
+};
+
+static_assert(sizeof(FileHeader) == 32, "FileHeader must be 32 bytes");
+static_assert(sizeof(BlockHeader) == 16, "BlockHeader must be 16 bytes");
+static_assert(sizeof(Record) == 16, "Record must be 16 bytes");
+
+/** The absolute time of a TIME_RECORD, in ticks. */
+inline int64_t getAbsoluteTime(const Record& record)
+{
+    int64_t time;
+    memcpy(&time, &record.value, sizeof(time));
+    return time;
+}
+
+inline void setAbsoluteTime(Record& record, int64_t time)
+{
+    memcpy(&record.value, &time, sizeof(time));
+}
+
+} // namespace binrec
+
+} // namespace inet
+
+#endif // ifndef __INET_BINARYRESULTFORMAT_H
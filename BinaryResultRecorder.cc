@@ -0,0 +1,171 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <cstring>
+
+#include "inet/common/queue/BinaryResultRecorder.h"
+
+namespace inet {
+
+Register_PerRunConfigOption(CFGID_BINARY_RECORDING_FILE, "binary-recording-file", CFG_FILENAME, "${resultdir}/${configname}-${runnumber}.qrec", "Name of the file written by the \"binary\" result recorder.");
+Register_PerRunConfigOption(CFGID_BINARY_RECORDING_BLOCK_SIZE, "binary-recording-block-size", CFG_INT, "65536", "Block size of the binary result file, in bytes.");
+
+Register_ResultRecorder("binary", BinaryResultRecorder);
+
+std::map<std::string, BinaryResultWriter *> BinaryResultWriter::writers;
+
+BinaryResultWriter::BinaryResultWriter(const std::string& fileName, uint32_t blockSize) :
+    fileName(fileName)
+{
+    if (blockSize < sizeof(binrec::BlockHeader) + sizeof(binrec::Record))
+        throw cRuntimeError("binary-recording-block-size %u is too small", blockSize);
+    file = fopen(fileName.c_str(), "wb");
+    if (!file)
+        throw cRuntimeError("Cannot open binary result file '%s'", fileName.c_str());
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, binrec::FILE_MAGIC, sizeof(header.magic));
+    header.version = binrec::VERSION;
+    header.blockSize = blockSize;
+    header.scaleExp = SimTime::getScaleExp();
+    if (fwrite(&header, sizeof(header), 1, file) != 1)
+        throw cRuntimeError("Cannot write binary result file '%s'", fileName.c_str());
+
+    block.assign(blockSize, 0);
+    blockHeader = reinterpret_cast<binrec::BlockHeader *>(block.data());
+    records = reinterpret_cast<binrec::Record *>(block.data() + sizeof(binrec::BlockHeader));
+    capacity = (blockSize - sizeof(binrec::BlockHeader)) / sizeof(binrec::Record);
+    blockHeader->magic = binrec::BLOCK_MAGIC;
+}
+
+BinaryResultWriter::~BinaryResultWriter()
+{
+    close();
+}
+
+BinaryResultWriter *BinaryResultWriter::acquire(const std::string& baseName)
+{
+    // every partition of a parallel run writes its own file
+    std::string fileName = baseName;
+    if (getSimulation()->getParsimNumPartitions() > 1)
+        fileName += "-" + std::to_string(getSimulation()->getParsimProcId());
+    BinaryResultWriter *& writer = writers[fileName];
+    if (!writer) {
+        cConfiguration *config = getEnvir()->getConfig();
+        writer = new BinaryResultWriter(fileName, (uint32_t)config->getAsInt(CFGID_BINARY_RECORDING_BLOCK_SIZE));
+    }
+    writer->refCount++;
+    return writer;
+}
+
+void BinaryResultWriter::release()
+{
+    if (--refCount == 0) {
+        writers.erase(fileName);
+        delete this;
+    }
+}
+
+uint16_t BinaryResultWriter::addStream(const std::string& module, const std::string& name)
+{
+    if (streams.size() > UINT16_MAX)
+        throw cRuntimeError("Too many streams in binary result file '%s'", fileName.c_str());
+    streams.push_back(std::make_pair(module, name));
+    return (uint16_t)(streams.size() - 1);
+}
+
+/**
+ * Appends a record. A gap that does not fit into the delta is bridged by a
+ * TIME_RECORD in the same block, so sparse streams do not waste blocks.
+ */
+void BinaryResultWriter::write(uint16_t stream, int64_t time, double value)
+{
+    uint32_t& count = blockHeader->count;
+    bool wide = count > 0 && time - lastTime > UINT32_MAX;
+    if (count > 0 && (count + (wide ? 2 : 1) > capacity || time < lastTime)) {
+        flushBlock();
+        wide = false;
+    }
+    if (count == 0) {
+        blockHeader->startTime = time;
+        lastTime = time;
+    }
+    if (wide) {
+        binrec::Record& escape = records[count++];
+        escape.stream = 0;
+        escape.flags = binrec::TIME_RECORD;
+        escape.delta = 0;
+        binrec::setAbsoluteTime(escape, time);
+        lastTime = time;
+    }
+    binrec::Record& record = records[count++];
+    record.stream = stream;
+    record.flags = 0;
+    record.delta = (uint32_t)(time - lastTime);
+    record.value = value;
+    lastTime = time;
+}
+
+void BinaryResultWriter::flushBlock()
+{
+    if (fwrite(block.data(), block.size(), 1, file) != 1)
+        throw cRuntimeError("Cannot write binary result file '%s'", fileName.c_str());
+    memset(block.data() + sizeof(binrec::BlockHeader), 0, block.size() - sizeof(binrec::BlockHeader));
+    blockHeader->count = 0;
+}
+
+/**
+ * Writes the last block and the stream table, then completes the header.
+ */
+void BinaryResultWriter::close()
+{
+    if (!file)
+        return;
+    if (blockHeader->count > 0)
+        flushBlock();
+    header.streamTableOffset = ftell(file);
+    header.numStreams = streams.size();
+    for (size_t i = 0; i < streams.size(); i++) {
+        uint16_t entry[3] = { (uint16_t)i, (uint16_t)streams[i].first.size(), (uint16_t)streams[i].second.size() };
+        fwrite(entry, sizeof(entry), 1, file);
+        fwrite(streams[i].first.data(), 1, streams[i].first.size(), file);
+        fwrite(streams[i].second.data(), 1, streams[i].second.size(), file);
+    }
+    fseek(file, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, file);
+    fclose(file);
+    file = nullptr;
+}
+
+BinaryResultRecorder::~BinaryResultRecorder()
+{
+    if (writer)
+        writer->release();
+}
+
+void BinaryResultRecorder::subscribedTo(cResultFilter *prev)
+{
+    cNumericResultRecorder::subscribedTo(prev);
+    if (!writer) {
+        writer = BinaryResultWriter::acquire(getEnvir()->getConfig()->getAsFilename(CFGID_BINARY_RECORDING_FILE));
+        stream = writer->addStream(getComponent()->getFullPath(), getResultName());
+    }
+}
+
+void BinaryResultRecorder::collect(simtime_t_cref t, double value, cObject *details)
+{
+    writer->write(stream, t.raw(), value);
+}
+
+} // namespace inet
@@ -0,0 +1,91 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef __INET_BINARYRESULTRECORDER_H
+#define __INET_BINARYRESULTRECORDER_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "inet/common/INETDefs.h"
+#include "inet/common/queue/BinaryResultFormat.h"
+
+namespace inet {
+
+/**
+ * Buffered writer of one binary result file (see BinaryResultFormat.h),
+ * shared by all BinaryResultRecorders of a run. A block is assembled in
+ * memory and written with a single fwrite() when it is full.
+ */
+class INET_API BinaryResultWriter
+{
+  protected:
+    static std::map<std::string, BinaryResultWriter *> writers;
+
+    std::string fileName;
+    FILE *file = nullptr;
+    int refCount = 0;
+    binrec::FileHeader header;
+    std::vector<char> block;
+    binrec::BlockHeader *blockHeader = nullptr;
+    binrec::Record *records = nullptr;
+    uint32_t capacity = 0;      // records per block
+    int64_t lastTime = 0;
+    std::vector<std::pair<std::string, std::string>> streams;
+
+  protected:
+    BinaryResultWriter(const std::string& fileName, uint32_t blockSize);
+    ~BinaryResultWriter();
+    void flushBlock();
+    void close();
+
+  public:
+    /**
+     * The writer of baseName, opened on first use; pair with release(). In
+     * a parallel run "-<partition id>" is appended to the file name.
+     */
+    static BinaryResultWriter *acquire(const std::string& baseName);
+    void release();
+
+    uint16_t addStream(const std::string& module, const std::string& name);
+    void write(uint16_t stream, int64_t time, double value);
+};
+
+/**
+ * Result recorder ("binary") that appends every value of a numeric signal
+ * as a 16 byte record to the run's binary result file, instead of an
+ * output vector. Use it for high-rate signals like queueLength,
+ * virtualSojournDelay, dropSojournTime, outTime and utilRate, e.g.
+ * **.queue.queueLength:result-recording-modes = binary, and read the file
+ * with tools/qrecdump. The file name is set by binary-recording-file.
+ */
+class INET_API BinaryResultRecorder : public cNumericResultRecorder
+{
+  protected:
+    BinaryResultWriter *writer = nullptr;
+    uint16_t stream = 0;
+
+  protected:
+    virtual void subscribedTo(cResultFilter *prev) override;
+    virtual void collect(simtime_t_cref t, double value, cObject *details) override;
+
+  public:
+    virtual ~BinaryResultRecorder();
+};
+
+} // namespace inet
+
+#endif // ifndef __INET_BINARYRESULTRECORDER_H
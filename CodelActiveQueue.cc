@@ -18,7 +18,8 @@
 
 #include "inet/common/INETDefs.h"
 #include "inet/common/queue/CodelActiveQueue.h"
-#include "math.h"
+#include "inet/common/queue/ECNMarker.h"
+#include "inet/common/queue/LinkDatarate.h"
 
 namespace inet {
 
@@ -33,14 +34,66 @@ simsignal_t CodelActiveQueue::virtualSojournDelaySignal = registerSignal("virtua
 simsignal_t CodelActiveQueue::dropCountSignal = registerSignal("dropCount");
 simsignal_t CodelActiveQueue::totalDropCountSignal = registerSignal("totalDropCount");
 
+/**
+ * Lets CodelCore::dequeue() pop and drop packets of the module's queue.
+ */
+class CodelActiveQueue::CodelQueueView
+{
+  public:
+    struct Item
+    {
+        cMessage *msg;
+        simtime_t enqueueTime;
+    };
+
+  protected:
+    CodelActiveQueue *owner;
+    simtime_t now;
+
+  public:
+    CodelQueueView(CodelActiveQueue *owner) : owner(owner), now(simTime()) {}
+
+    Item pop()
+    {
+        Item item;
+        item.enqueueTime = owner->queue.frontEnqueueTime();
+        item.msg = owner->queue.pop();
+        return item;
+    }
+
+    CodelCore::ticks_t enqueueTime(const Item& item) const { return item.enqueueTime.raw(); }
+
+    long backlog() const { return (long)owner->queue.getTotalByteLength(); }
+
+    bool mark(Item& item) { return owner->useEcn && ECNMarker::markCE(check_and_cast<cPacket *>(item.msg)); }
+
+    void drop(const Item& item)
+    {
+        owner->numQueueDropped++;
+        owner->emit(dropPkByQueueSignal, item.msg);
+        if (owner->stats.isEnabled()) {
+            owner->stats.dropped(now);
+            owner->stats.lengthChanged(now, owner->queue.getLength());
+        }
+        else {
+            owner->emit(queueLengthSignal, owner->queue.getLength());
+            owner->emit(dropCountSignal, owner->codel.getCount());
+            owner->emit(dropSojournTimeSignal, now - item.enqueueTime);
+            owner->emit(totalDropCountSignal, owner->codel.getTotalDropCount());
+        }
+        delete item.msg;
+    }
+};
+
+CodelActiveQueue::~CodelActiveQueue()
+{
+    cancelAndDelete(snapshotTimer);
+}
+
 void CodelActiveQueue::initialize()
 {
     PassiveQueueBase::initialize();
-    next_drop_time = 0;
-    total_drop_count = 0;
-    drop_state = false;
 
-    queue.setName(par("queueName"));
     emit(queueLengthSignal, 0);
     //Emits the given object as a signal.
     //If the given signal has listeners in this component or in ancestor components, their appropriate receiveSignal() methods are called. If there are no listeners, the runtime cost is usually minimal.
@@ -48,24 +101,119 @@ void CodelActiveQueue::initialize()
 
     // configuration
     frameCapacity = par("frameCapacity"); // number of packets
-    MTU = par("MTU"); // ethernet 1500
-    adapt = par("adapt");
-    interval = simtime_t(par("interval")); // simtime_t  simulationTime ǹ
-    target = simtime_t(par("target"));
-    gate_period = simtime_t(par("gate_period"));
-    blocking_time = simtime_t(par("gate_rate") * gate_period);
+    queue.setCapacity(frameCapacity);
+    byteCapacity = par("byteCapacity"); // 0 means unlimited
+    CodelCore::Parameters params;
+    params.mtu = par("MTU"); // bytes, ethernet 1500; compared against the byte backlog
+    params.adapt = par("adapt").intValue() != 0;
+    params.interval = simtime_t(par("interval")).raw(); // simtime_t  simulationTime ǹ
+    params.target = simtime_t(par("target")).raw();
+    simtime_t gate_period = simtime_t(par("gate_period"));
+    params.gatePeriod = gate_period.raw();
+    params.blockingTime = simtime_t(par("gate_rate") * gate_period).raw();
+    if (params.adapt && (params.gatePeriod <= 0 || params.blockingTime <= 0))
+        throw cRuntimeError("adapt needs a positive gate_period and gate_rate");
+    params.fast = par("fastMode"); // integer-only CoDel arithmetic
+    useEcn = par("useEcn"); // mark ECN-capable packets instead of dropping them
+    admissionBound = simtime_t(par("admissionBound"));
+    if (admissionBound > SIMTIME_ZERO) {
+        double datarate = par("datarate"); // 0: the datarate of the link behind the scheduler
+        if (datarate < 0)
+            throw cRuntimeError("Invalid datarate %g bps, must be positive, or 0 to use the link's", datarate);
+        if (datarate == 0)
+            datarate = getLinkDatarate(this);
+        serialization = SerializationModel(SimTime::getScale(), datarate, par("frameOverhead"));
+    }
+    admissionCalendar = GateCalendar(params.gatePeriod, params.blockingTime);
+    codel.setParameters(params);
+    codel.reset();
+    stats.initialize(par("statisticsInterval"), simTime(), 0);
+
+    // warm start
+    snapshotDir = par("snapshotDir").stdstringValue();
+    if (par("restoreSnapshot"))
+        restoreSnapshot();
+    double snapshotTime = par("snapshotTime");
+    if (snapshotTime >= 0) {
+        snapshotTimer = new cMessage("snapshot");
+        scheduleAt(snapshotTime, snapshotTimer);
+    }
+}
+
+void CodelActiveQueue::handleMessage(cMessage *msg)
+{
+    if (msg == snapshotTimer)
+        saveSnapshot();
+    else
+        PassiveQueueBase::handleMessage(msg);
+}
+
+void CodelActiveQueue::saveSnapshot()
+{
+    Snapshot snapshot(simTime());
+    CodelCore::State state = codel.getState();
+    snapshot.put("count", (int64_t)state.count);
+    snapshot.put("lastCount", (int64_t)state.lastCount);
+    snapshot.putTime("nextDropTime", SimTime().setRaw(state.nextDropTime));
+    snapshot.put("dropping", (int64_t)state.dropping);
+    snapshot.put("recInvSqrt", (int64_t)state.recInvSqrt);
+    for (int i = 0; i < queue.getLength(); i++)
+        snapshot.putPacket(queue.get(i), queue.getEnqueueTime(i));
+    snapshot.save(Snapshot::getFileName(this, snapshotDir.c_str()));
+}
+
+void CodelActiveQueue::restoreSnapshot()
+{
+    Snapshot snapshot(simTime());
+    snapshot.load(Snapshot::getFileName(this, snapshotDir.c_str()));
+    CodelCore::State state;
+    state.count = snapshot.getInt("count");
+    state.lastCount = snapshot.getInt("lastCount");
+    state.nextDropTime = snapshot.getTime("nextDropTime").raw();
+    state.dropping = snapshot.getInt("dropping") != 0;
+    state.recInvSqrt = (uint32_t)snapshot.getInt("recInvSqrt");
+    codel.setState(state, simTime().raw());
+    for (int i = 0; i < (int)snapshot.getPackets().size(); i++) {
+        // the same limits as enqueue()
+        simtime_t enqueueTime;
+        cPacket *packet = snapshot.createPacket(i, enqueueTime);
+        if ((frameCapacity && queue.getLength() >= frameCapacity)
+            || (byteCapacity && queue.getTotalByteLength() + packet->getByteLength() > byteCapacity))
+        {
+            delete packet;
+            throw cRuntimeError("Snapshot holds more packets than frameCapacity or more bytes than byteCapacity");
+        }
+        queue.insert(packet, enqueueTime);
+    }
+    emit(queueLengthSignal, queue.getLength());
 }
 
 cMessage *CodelActiveQueue::enqueue(cMessage *msg) // ̺κ ĺ
 {
-    if (frameCapacity && queue.getLength() >= frameCapacity) {
+    if ((frameCapacity && queue.getLength() >= frameCapacity)
+        || (byteCapacity && queue.getTotalByteLength() + check_and_cast<cPacket *>(msg)->getByteLength() > byteCapacity))
+    {
         EV << "Queue full, dropping packet.\n";
+        counters.tailDropped();
+        if (stats.isEnabled())
+            stats.dropped(simTime());
+        return msg;
+    }
+    else if (admissionBound > SIMTIME_ZERO && predictSojourn(check_and_cast<cPacket *>(msg)->getByteLength()) > admissionBound) {
+        EV << "Predicted sojourn time exceeds " << admissionBound << ", dropping packet.\n";
+        counters.packetsIn++;
+        numAdmissionDrops++;
+        if (stats.isEnabled())
+            stats.dropped(simTime());
         return msg;
     }
     else {
-        msg->setTimestamp(simTime());
-        queue.insert(msg);
-        emit(queueLengthSignal, queue.getLength());
+        queue.insert(msg, simTime());
+        counters.enqueued(queue.getLength(), queue.getTotalByteLength());
+        if (stats.isEnabled())
+            stats.lengthChanged(simTime(), queue.getLength());
+        else
+            emit(queueLengthSignal, queue.getLength());
         return nullptr;
     }
 }
@@ -75,148 +223,60 @@ cMessage *CodelActiveQueue::dequeue()
     if (queue.isEmpty())
         return nullptr;
 
-    cMessage *msg = (cMessage *)queue.pop();
-    emit(queueLengthSignal, queue.getLength());
-
-    simtime_t dequeue_time = simTime();
-    simtime_t enqueue_time = msg->getTimestamp();
-    simtime_t sojourn_time = dequeue_time - enqueue_time;
-    int delta;
-
-    int n2 = dequeue_time/gate_period;
-    simtime_t dequeue_open_time = gate_period*(n2); // gate ð
-    simtime_t dequeue_close_time = dequeue_open_time + blocking_time; // gate ð
-    if(adapt)
-    {
-        if(enqueue_time < dequeue_open_time)
-        {
-            int n1 = enqueue_time/gate_period;
-            simtime_t enqueue_open_time = gate_period*(n1); // gate ð
-            simtime_t enqueue_close_time = enqueue_open_time + blocking_time; // gate ð
-
-            int n = n2 - n1 - 1; // virtual sojourn time
-            if(enqueue_close_time>enqueue_time)
-            {
-                sojourn_time = (enqueue_close_time - enqueue_time) + (dequeue_time - dequeue_open_time) + (n * blocking_time);
-            }
-            else
-            {
-                sojourn_time = (dequeue_time - dequeue_open_time) + (n * blocking_time);
-            }
-        }
-        else
-        {
-            sojourn_time = dequeue_time - enqueue_time;
-        }
-    }
-
-    if(drop_state)
-    {
-        if(sojourn_time < target || queue.getLength() < MTU)
-        {
-            drop_state = false;
-        }
-        else
-        {
-            while(dequeue_time >= next_drop_time && drop_state)
-            {
-                numQueueDropped++;
-                msg = check_and_cast<cMessage*>(queue.pop());//drop
-                emit(dropPkByQueueSignal, msg);
-                emit(queueLengthSignal, queue.getLength());
-                enqueue_time = msg->getTimestamp();
-
-
-                sojourn_time = dequeue_time - enqueue_time;
-
-                if(adapt)
-                {
-                    if(enqueue_time < dequeue_open_time)
-                    {
-                        int n1 = enqueue_time/gate_period;
-                        simtime_t enqueue_open_time = gate_period*(n1);
-                        simtime_t enqueue_close_time = enqueue_open_time + blocking_time;
-
-                        int n = n2 - n1 - 1;
-                        if(enqueue_close_time>enqueue_time)
-                        {
-                            sojourn_time = (enqueue_close_time - enqueue_time) + (dequeue_time - dequeue_open_time) + (n * blocking_time);
-                        }
-                        else
-                        {
-                            sojourn_time = (dequeue_time - dequeue_open_time) + (n * blocking_time);
-                        }
-                    }
-                    else
-                    {
-                        sojourn_time = dequeue_time - enqueue_time;
-                    }
-                }
-
-                count++;
-                total_drop_count++;
-                emit(dropCountSignal, count);
-                emit(dropSojournTimeSignal, simtime_t(dequeue_time-(msg->getTimestamp())));
-                emit(totalDropCountSignal, total_drop_count);
-
-                if(sojourn_time < target || queue.getLength() < MTU)
-                {
-                    drop_state = false;
-                }
-                else
-                {
-                    next_drop_time = control_law(next_drop_time, count);
-
-                    if(adapt)
-                    {
-                        if(dequeue_close_time < next_drop_time)
-                        {
-                            int n = (next_drop_time - dequeue_close_time)/blocking_time + 1;
-                            next_drop_time = next_drop_time + blocking_time*n;
-                        }
-                    }
-                }
-            }
-        }
+    CodelQueueView view(this);
+    cMessage *msg = codel.dequeue(simTime().raw(), view).msg;
+    counters.dequeued();
+    simtime_t sojournTime = SimTime().setRaw(codel.getLastSojournTime());
+    if (stats.isEnabled()) {
+        stats.sojournTime(simTime(), sojournTime);
+        stats.lengthChanged(simTime(), queue.getLength());
     }
-    else if(sojourn_time >= target && queue.getLength() >= MTU)
-    {
-        numQueueDropped++;
-        emit(dropPkByQueueSignal, msg);
-        msg = check_and_cast<cMessage*>(queue.pop());//drop
-        drop_state = true;
-        delta  = count - last_count;
-        count = 1;
-        total_drop_count++;
-
-        if((delta > 1) && (dequeue_time - next_drop_time < 16 * interval))
-            count = delta;
-        emit(dropCountSignal, count);
-        emit(totalDropCountSignal, total_drop_count);
-        emit(dropSojournTimeSignal, simtime_t(dequeue_time-(msg->getTimestamp())));
-        next_drop_time = control_law(dequeue_time, count);
-        if(adapt)
-        {
-            if(dequeue_close_time < next_drop_time)
-            {
-                int n = (next_drop_time - dequeue_close_time)/blocking_time + 1;
-                next_drop_time = next_drop_time + blocking_time*n;
-            }
-        }
-        last_count = count;
+    else {
+        emit(queueLengthSignal, queue.getLength());
+        emit(virtualSojournDelaySignal, sojournTime);
     }
-    emit(virtualSojournDelaySignal, sojourn_time);
     return msg;
 }
 
-cMessage *CodelActiveQueue::getFirstMsg()
+simtime_t CodelActiveQueue::predictSojourn(int64_t byteLength)
+{
+    typedef CodelCore::ticks_t ticks_t;
+    int64_t bytes = queue.getTotalByteLength() + byteLength + (int64_t)(queue.getLength() + 1) * serialization.getOverhead();
+    ticks_t work = serialization.bitDuration(bytes * 8);
+    const CodelCore::Parameters& params = codel.getParameters();
+    if (params.adapt || params.gatePeriod <= 0)
+        return SimTime().setRaw(work); // only open gate time counts
+    if (params.blockingTime <= 0)
+        return SimTime::getMaxTime(); // the gate never opens
+
+    // the rest of the current window, then as many windows as needed
+    ticks_t now = simTime().raw();
+    admissionCalendar.seek(admissionCursor, now);
+    ticks_t closeTime = admissionCalendar.getCloseTime(admissionCursor);
+    ticks_t open = closeTime > now ? closeTime - now : 0;
+    if (work <= open)
+        return SimTime().setRaw(work);
+    work -= open;
+    int64_t fullWindows = (work - 1) / params.blockingTime;
+    ticks_t departure = admissionCalendar.getNextOpenTime(admissionCursor) + fullWindows * params.gatePeriod
+        + (work - fullWindows * params.blockingTime);
+    return SimTime().setRaw(departure - now);
+}
+
+void CodelActiveQueue::finish()
 {
-    return check_and_cast<cMessage*>(queue.get(0));
+    PassiveQueueBase::finish();
+    stats.recordScalars(this, simTime());
+    counters.recordScalars(this);
+    recordScalar("dropped:head", codel.getTotalDropCount());
+    recordScalar("marked:ce", codel.getTotalMarkCount());
+    recordScalar("dropped:admission", numAdmissionDrops);
+    recordScalar("dropState:time", SimTime().setRaw(codel.getDropStateTime(simTime().raw())), "s");
 }
 
-simtime_t CodelActiveQueue::control_law(simtime_t t, int count)
+cMessage *CodelActiveQueue::getFirstMsg()
 {
-    return t + interval/sqrt(count);
+    return queue.front();
 }
 
 void CodelActiveQueue::sendOut(cMessage *msg)
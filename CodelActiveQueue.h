@@ -21,31 +21,37 @@
 
 #include "inet/common/INETDefs.h"
 #include "inet/common/queue/PassiveQueueBase.h"
+#include "inet/common/queue/IQueueAccess.h"
+#include "inet/common/queue/IPeekableQueue.h"
+#include "inet/common/queue/CodelCore.h"
+#include "inet/common/queue/PacketRing.h"
+#include "inet/common/queue/QueueStatistics.h"
+#include "inet/common/queue/QueueCounters.h"
+#include "inet/common/queue/SerializationModel.h"
+#include "inet/common/queue/Snapshot.h"
 
 namespace inet {
 
-class INET_API CodelActiveQueue : public PassiveQueueBase
+class INET_API CodelActiveQueue : public PassiveQueueBase, public IQueueAccess, public IPeekableQueue
 {
     protected:
+      class CodelQueueView;
+
       // configuration
       int frameCapacity;
-      simtime_t interval;
-      simtime_t target;
-      int MTU;
-      int count = 0;
-      int last_count = 0;
-      int total_drop_count = 0;
-      simtime_t next_drop_time = 0;
-      bool drop_state = false;
-
-      // for gated adopt codel
-      int adapt;
-      simtime_t blocking_time;
-      simtime_t gate_period;
+      int byteCapacity;
+      bool useEcn;
+      simtime_t admissionBound; // reject packets predicted to wait longer; 0 disables
+      SerializationModel serialization;
+      GateCalendar admissionCalendar;
+      GateCalendar::Cursor admissionCursor;
 
       // state
-      cQueue queue;
+      CodelCore codel; // interval, target, MTU and the gated adapt parameters live here
+      PacketRing queue;
       cGate *outGate;
+      std::string snapshotDir;
+      cMessage *snapshotTimer = nullptr;
 
       // statistics
       static simsignal_t queueLengthSignal;
@@ -53,9 +59,30 @@ class INET_API CodelActiveQueue : public PassiveQueueBase
       static simsignal_t virtualSojournDelaySignal;
       static simsignal_t dropCountSignal;
       static simsignal_t totalDropCountSignal;
+      QueueStatistics stats; // replaces the per-packet signals when statisticsInterval >= 0
+      QueueCounters counters;
+      long numAdmissionDrops = 0;
+
+    public:
+      virtual ~CodelActiveQueue();
 
     protected:
       virtual void initialize() override;
+      virtual void handleMessage(cMessage *msg) override;
+      virtual void finish() override;
+
+      /** Writes the CoDel state and the queued packets to the snapshot file. */
+      virtual void saveSnapshot();
+      virtual void restoreSnapshot();
+
+      /**
+       * Sojourn time a packet of byteLength arriving now would see, in the
+       * same terms CoDel compares against target: the link time of the
+       * byte backlog ahead of it, stretched over the gate schedule unless
+       * adapt is set.
+       */
+      simtime_t predictSojourn(int64_t byteLength);
+
       /**
        * Redefined from PassiveQueueBase.
        */
@@ -66,8 +93,6 @@ class INET_API CodelActiveQueue : public PassiveQueueBase
        */
       virtual cMessage *dequeue() override;
 
-      virtual simtime_t control_law(simtime_t t, int count);
-
       /**
        * Redefined from PassiveQueueBase.
        */
@@ -79,7 +104,14 @@ class INET_API CodelActiveQueue : public PassiveQueueBase
       virtual bool isEmpty() override;
 
     public:
-      cMessage *getFirstMsg();
+      virtual cMessage *getFirstMsg() override;
+
+      virtual int getLength() const override { return queue.getLength(); }
+      virtual int getByteLength() const override { return (int)queue.getTotalByteLength(); }
+
+      virtual int getPeekLength() const override { return queue.getLength(); }
+      virtual cMessage *getMsg(int i) const override { return queue.get(i); }
+      virtual int64_t getMsgByteLength(int i) const override { return queue.getByteLength(i); }
 };
 
 } // namespace inet
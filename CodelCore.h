@@ -0,0 +1,339 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef __INET_CODELCORE_H
+#define __INET_CODELCORE_H
+
+#include <cmath>
+#include <cstdint>
+
+#include "inet/common/queue/GateCalendar.h"
+
+namespace inet {
+
+/**
+ * CoDel drop decision logic (including the gated "adapt" virtual sojourn
+ * time) without any OMNeT++ dependency. It is shared by CodelActiveQueue
+ * and the aqmreplay tool, so both make the same decisions.
+ *
+ * All times are raw simulation time ticks (SimTime::raw()). Operations
+ * that involve a double are rounded the same way SimTime rounds them. Gate
+ * cycles are tracked by a GateCalendar with one cursor following the
+ * dequeue time and one following the enqueue time of the head packet.
+ *
+ * In fast mode no floating point is used at all: the control law
+ * multiplies the interval by a cached Q0.32 reciprocal square root of
+ * count that is kept up to date with one Newton step per count change, as
+ * the Linux codel does.
+ */
+class CodelCore
+{
+  public:
+    typedef int64_t ticks_t;
+
+    struct Parameters
+    {
+        ticks_t interval = 0;
+        ticks_t target = 0;
+        long mtu = 1500;          // minimum backlog in bytes for dropping
+        bool adapt = false;       // use the gate-aware virtual sojourn time
+        ticks_t gatePeriod = 0;
+        ticks_t blockingTime = 0; // gate_rate * gate_period
+        bool fast = false;        // integer-only arithmetic, see class comment
+    };
+
+    /**
+     * Controller state carried over by warm-start snapshots. The drop and
+     * mark totals are not part of it, they start over after a restore.
+     */
+    struct State
+    {
+        int count = 0;
+        int lastCount = 0;
+        ticks_t nextDropTime = 0;
+        bool dropping = false;
+        uint32_t recInvSqrt = ~0u;
+    };
+
+    /** Counts below this take their reciprocal square root from a table. */
+    static const int REC_INV_SQRT_CACHE = 16;
+
+  protected:
+    Parameters params;
+
+    // state
+    int count = 0;
+    int lastCount = 0;
+    long totalDropCount = 0;
+    long totalMarkCount = 0;
+    ticks_t nextDropTime = 0;
+    bool dropping = false;
+    ticks_t lastSojournTime = 0;
+    ticks_t dropStateStart = 0;  // when dropping last became true
+    ticks_t dropStateTime = 0;   // time spent dropping before that
+    uint32_t recInvSqrt = ~0u;   // 1/sqrt(count) in Q0.32, fast mode only
+
+    GateCalendar calendar;
+    GateCalendar::Cursor dequeueCursor;
+    GateCalendar::Cursor enqueueCursor;
+
+  public:
+    /** Same as SimTime * double. */
+    static ticks_t scale(ticks_t t, double d) { return toTicks((double)t * d); }
+
+    /** Same as SimTime / double. */
+    static ticks_t divide(ticks_t t, double d) { return toTicks((double)t / d); }
+
+    /** Same as int n = SimTime / SimTime. */
+    static int quotient(ticks_t a, ticks_t b) { return (int)((double)a / (double)b); }
+
+    /** val * ratio / 2^32 without overflowing 64 bits. */
+    static ticks_t reciprocalScale(ticks_t val, uint32_t ratio)
+    {
+        uint64_t v = (uint64_t)val;
+        return (ticks_t)((v >> 32) * ratio + (((v & 0xffffffffu) * ratio) >> 32));
+    }
+
+    /** Exact 1/sqrt(count) in Q0.32 for counts below REC_INV_SQRT_CACHE. */
+    static const uint32_t *recInvSqrtCache()
+    {
+        static const struct Table {
+            uint32_t values[REC_INV_SQRT_CACHE];
+            Table()
+            {
+                values[0] = values[1] = ~0u;
+                for (int i = 2; i < REC_INV_SQRT_CACHE; i++)
+                    values[i] = (uint32_t)(4294967296.0 / std::sqrt((double)i));
+            }
+        } table;
+        return table.values;
+    }
+
+  protected:
+    static ticks_t toTicks(double d) { return (ticks_t)std::floor(d + 0.5); }
+
+    /**
+     * Updates recInvSqrt after count changed: a table lookup for small
+     * counts, otherwise one Newton iteration x' = x * (3 - count * x^2) / 2
+     * starting from the value for the previous count.
+     */
+    void newtonStep()
+    {
+        if (count < REC_INV_SQRT_CACHE) {
+            recInvSqrt = recInvSqrtCache()[count];
+            return;
+        }
+        uint64_t invsqrt = recInvSqrt;
+        uint64_t invsqrt2 = (invsqrt * invsqrt) >> 32;
+        uint64_t val = (3ull << 32) - (uint64_t)count * invsqrt2;
+        val >>= 2; // avoid overflow in the following multiply
+        val = (val * invsqrt) >> (32 - 2 + 1);
+        recInvSqrt = (uint32_t)val;
+    }
+
+  public:
+    CodelCore() {}
+
+    void setParameters(const Parameters& p)
+    {
+        params = p;
+        calendar = GateCalendar(p.gatePeriod, p.blockingTime);
+    }
+    const Parameters& getParameters() const { return params; }
+
+    void reset()
+    {
+        count = lastCount = 0;
+        totalDropCount = 0;
+        totalMarkCount = 0;
+        nextDropTime = 0;
+        dropping = false;
+        lastSojournTime = 0;
+        dropStateStart = dropStateTime = 0;
+        recInvSqrt = ~0u;
+        dequeueCursor = enqueueCursor = GateCalendar::Cursor();
+    }
+
+    State getState() const
+    {
+        State state;
+        state.count = count;
+        state.lastCount = lastCount;
+        state.nextDropTime = nextDropTime;
+        state.dropping = dropping;
+        state.recInvSqrt = recInvSqrt;
+        return state;
+    }
+
+    /** Resets the controller and resumes from state at now. */
+    void setState(const State& state, ticks_t now)
+    {
+        reset();
+        count = state.count;
+        lastCount = state.lastCount;
+        nextDropTime = state.nextDropTime;
+        dropping = state.dropping;
+        recInvSqrt = state.recInvSqrt;
+        dropStateStart = now;
+    }
+
+    int getCount() const { return count; }
+    long getTotalDropCount() const { return totalDropCount; }
+    long getTotalMarkCount() const { return totalMarkCount; }
+    ticks_t getNextDropTime() const { return nextDropTime; }
+    bool isDropping() const { return dropping; }
+
+    /** Total time spent in the dropping state up to now. */
+    ticks_t getDropStateTime(ticks_t now) const { return dropStateTime + (dropping ? now - dropStateStart : 0); }
+
+    /** Sojourn time used by the last dequeue() decision. */
+    ticks_t getLastSojournTime() const { return lastSojournTime; }
+
+    /**
+     * t + interval/sqrt(count). In fast mode the cached reciprocal square
+     * root, which tracks the current count, is used instead of count.
+     */
+    ticks_t controlLaw(ticks_t t, int count) const
+    {
+        if (params.fast)
+            return t + reciprocalScale(params.interval, recInvSqrt);
+        return t + divide(params.interval, std::sqrt((double)count));
+    }
+
+    /**
+     * Sojourn time of a packet. With adapt set, only the time the gate was
+     * open counts: full cycles in between contribute blocking_time each.
+     * Calls should follow FIFO order so the calendar cursors move forward.
+     */
+    ticks_t sojournTime(ticks_t enqueueTime, ticks_t dequeueTime)
+    {
+        if (!params.adapt)
+            return dequeueTime - enqueueTime;
+        calendar.seek(dequeueCursor, dequeueTime);
+        calendar.seek(enqueueCursor, enqueueTime);
+        return calendar.openTimeBetween(enqueueCursor, enqueueTime, dequeueCursor, dequeueTime);
+    }
+
+    /**
+     * Runs one CoDel dequeue on a non-empty queue and returns the packet to
+     * deliver. Queue must provide:
+     *
+     *   typedef ... Item;
+     *   Item pop();
+     *   ticks_t enqueueTime(const Item&) const;
+     *   long backlog() const;      // bytes left queued, compared against Parameters::mtu
+     *   bool mark(Item&);          // sets CE instead of dropping; false if the packet must be dropped
+     *   void drop(Item);           // called after the counters are updated
+     *
+     * A marked packet is delivered and ends the dequeue, as in Linux: the
+     * drop schedule advances exactly as if it had been dropped.
+     */
+    template<typename Queue>
+    typename Queue::Item dequeue(ticks_t now, Queue& queue)
+    {
+        typename Queue::Item item = queue.pop();
+        ticks_t sojourn = sojournTime(queue.enqueueTime(item), now);
+
+        if (dropping) {
+            if (sojourn < params.target || queue.backlog() < params.mtu)
+                leaveDropState(now);
+            else {
+                while (now >= nextDropTime && dropping) {
+                    if (queue.mark(item)) {
+                        count++;
+                        if (params.fast)
+                            newtonStep();
+                        totalMarkCount++;
+                        nextDropTime = skipClosedGate(now, controlLaw(nextDropTime, count));
+                        break;
+                    }
+                    typename Queue::Item next = queue.pop();
+                    count++;
+                    if (params.fast)
+                        newtonStep();
+                    totalDropCount++;
+                    queue.drop(item);
+                    item = next;
+                    sojourn = sojournTime(queue.enqueueTime(item), now);
+                    if (sojourn < params.target || queue.backlog() < params.mtu)
+                        leaveDropState(now);
+                    else
+                        nextDropTime = skipClosedGate(now, controlLaw(nextDropTime, count));
+                }
+            }
+        }
+        else if (sojourn >= params.target && queue.backlog() >= params.mtu) {
+            bool marked = queue.mark(item);
+            typename Queue::Item next = item;
+            if (!marked)
+                next = queue.pop();
+            dropping = true;
+            dropStateStart = now;
+            int delta = count - lastCount;
+            count = 1;
+            if (delta > 1 && now - nextDropTime < 16 * params.interval)
+                count = delta;
+            if (params.fast) {
+                // not exact for delta beyond the table, later Newton steps converge quadratically
+                if (count == 1)
+                    recInvSqrt = ~0u;
+                else
+                    newtonStep();
+            }
+            if (marked)
+                totalMarkCount++;
+            else {
+                totalDropCount++;
+                queue.drop(item);
+                item = next;
+            }
+            nextDropTime = skipClosedGate(now, controlLaw(now, count));
+            lastCount = count;
+        }
+        lastSojournTime = sojourn;
+        return item;
+    }
+
+  protected:
+    void leaveDropState(ticks_t now)
+    {
+        dropping = false;
+        dropStateTime += now - dropStateStart;
+    }
+
+    /**
+     * With adapt set, pushes a drop time that falls after the close of the
+     * current gate window out by whole blocking_time units. A gate that is
+     * never open has no such units and leaves the drop time as it is.
+     */
+    ticks_t skipClosedGate(ticks_t now, ticks_t dropTime)
+    {
+        if (!params.adapt || params.blockingTime <= 0)
+            return dropTime;
+        calendar.seek(dequeueCursor, now);
+        ticks_t dequeueCloseTime = calendar.getCloseTime(dequeueCursor);
+        if (dequeueCloseTime < dropTime) {
+            int64_t n = params.fast ? (dropTime - dequeueCloseTime) / params.blockingTime
+                                    : quotient(dropTime - dequeueCloseTime, params.blockingTime);
+            dropTime += params.blockingTime * (n + 1);
+        }
+        return dropTime;
+    }
+};
+
+} // namespace inet
+
+#endif // ifndef __INET_CODELCORE_H
+
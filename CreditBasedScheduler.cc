@@ -0,0 +1,165 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <algorithm>
+#include <cmath>
+
+#include "inet/common/queue/CreditBasedScheduler.h"
+#include "inet/common/queue/LinkDatarate.h"
+#include "inet/common/queue/PartitionCheck.h"
+
+namespace inet {
+
+Define_Module(CreditBasedScheduler);
+
+CreditBasedScheduler::~CreditBasedScheduler()
+{
+    cancelAndDelete(wakeTimer);
+}
+
+void CreditBasedScheduler::initialize()
+{
+    checkLocalPeers(this);
+    SchedulerBase::initialize();
+
+    double datarate = par("datarate");
+    if (datarate <= 0)
+        datarate = getLinkDatarate(this);
+    serialization = SerializationModel(SimTime::getScale(), datarate, par("frameOverhead"));
+
+    // idle slopes in input order; missing entries leave the input unshaped
+    shapers.resize(inputQueues.size());
+    cStringTokenizer tokenizer(par("idleSlopes"));
+    for (size_t i = 0; i < shapers.size() && tokenizer.hasMoreTokens(); i++) {
+        double idleSlope = cNEDValue::parseQuantity(tokenizer.nextToken(), "bps");
+        if (idleSlope < 0 || idleSlope >= datarate)
+            throw cRuntimeError("Invalid idle slope %g bps for input %d, must be below the datarate (%g bps)", idleSlope, (int)i, datarate);
+        shapers[i].idleSlope = idleSlope;
+    }
+    wakeTimer = new cMessage("creditWake");
+}
+
+void CreditBasedScheduler::handleMessage(cMessage *msg)
+{
+    if (msg == wakeTimer) {
+        numWakeups++;
+        if (packetsToBeRequestedFromInputs > 0) {
+            while (packetsToBeRequestedFromInputs > 0 && schedulePacket())
+                packetsToBeRequestedFromInputs--;
+        }
+        else if (packetsRequestedFromUs == 0)
+            notifyListeners();
+        return;
+    }
+
+    // charge the frame against the credit of the input it came from
+    int i = msg->getArrivalGate()->getIndex();
+    Shaper& shaper = shapers[i];
+    if (shaper.idleSlope > 0) {
+        simtime_t start = std::max(simTime(), shaper.creditTime);
+        simtime_t duration = SimTime().setRaw(serialization.frameDuration(check_and_cast<cPacket *>(msg)->getByteLength()));
+        shaper.credit = creditAt(shaper, start) + (shaper.idleSlope - serialization.getDatarate()) * duration.dbl();
+        shaper.creditTime = start + duration;
+        shaper.backlogged = !inputQueues[i]->isEmpty();
+    }
+    numSent++;
+    SchedulerBase::handleMessage(msg);
+}
+
+void CreditBasedScheduler::packetEnqueued(IPassiveQueue *inputQueue)
+{
+    auto it = std::find(inputQueues.begin(), inputQueues.end(), inputQueue);
+    if (it != inputQueues.end()) {
+        Shaper& shaper = shapers[it - inputQueues.begin()];
+        if (!shaper.backlogged) {
+            // close the idle period: negative credit recovered up to 0 at most
+            simtime_t now = simTime();
+            if (now > shaper.creditTime) {
+                shaper.credit = creditAt(shaper, now);
+                shaper.creditTime = now;
+            }
+            shaper.backlogged = true;
+        }
+    }
+    SchedulerBase::packetEnqueued(inputQueue);
+}
+
+double CreditBasedScheduler::creditAt(const Shaper& shaper, simtime_t t) const
+{
+    double credit = shaper.credit + shaper.idleSlope * (t - shaper.creditTime).dbl();
+    if (!shaper.backlogged)
+        credit = std::min(credit, 0.0);
+    return credit;
+}
+
+simtime_t CreditBasedScheduler::eligibleTime(const Shaper& shaper) const
+{
+    if (shaper.credit >= 0)
+        return shaper.creditTime;
+    double ticks = std::ceil(-shaper.credit / shaper.idleSlope * SimTime::getScale());
+    return shaper.creditTime + SimTime().setRaw((int64_t)ticks);
+}
+
+bool CreditBasedScheduler::schedulePacket()
+{
+    simtime_t now = simTime();
+    simtime_t wakeTime = SIMTIME_MAX;
+    for (size_t i = 0; i < inputQueues.size(); i++) {
+        IPassiveQueue *inputQueue = inputQueues[i];
+        if (inputQueue->isEmpty())
+            continue;
+        const Shaper& shaper = shapers[i];
+        if (shaper.idleSlope <= 0) {
+            inputQueue->requestPacket();
+            return true;
+        }
+        simtime_t t = eligibleTime(shaper);
+        if (t <= now) {
+            inputQueue->requestPacket();
+            return true;
+        }
+        wakeTime = std::min(wakeTime, t);
+    }
+    if (wakeTime != SIMTIME_MAX) {
+        if (wakeTimer->isScheduled() && wakeTimer->getArrivalTime() != wakeTime)
+            cancelEvent(wakeTimer);
+        if (!wakeTimer->isScheduled())
+            scheduleAt(wakeTime, wakeTimer);
+    }
+    return false;
+}
+
+void CreditBasedScheduler::finish()
+{
+    SchedulerBase::finish();
+    recordScalar("packets:out", numSent);
+    recordScalar("wakeups", numWakeups);
+}
+
+void CreditBasedScheduler::refreshDisplay() const
+{
+    std::string text;
+    char buf[64];
+    for (size_t i = 0; i < shapers.size(); i++) {
+        if (shapers[i].idleSlope <= 0)
+            continue;
+        simtime_t t = std::max(simTime(), shapers[i].creditTime);
+        sprintf(buf, "%scredit[%d]: %.0f", text.empty() ? "" : "\n", (int)i, creditAt(shapers[i], t));
+        text += buf;
+    }
+    getDisplayString().setTagArg("t", 0, text.c_str());
+}
+
+} // namespace inet
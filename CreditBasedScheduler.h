@@ -0,0 +1,82 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef __INET_CREDITBASEDSCHEDULER_H
+#define __INET_CREDITBASEDSCHEDULER_H
+
+#include <vector>
+
+#include "inet/common/INETDefs.h"
+#include "inet/common/queue/SchedulerBase.h"
+#include "inet/common/queue/SerializationModel.h"
+
+namespace inet {
+
+/**
+ * 802.1Qav credit-based shaper over any IPassiveQueue inputs, with strict
+ * priority in input order. An input with a positive idle slope may send
+ * only while its credit is not negative; inputs without an idle slope are
+ * not shaped.
+ *
+ * Credit is kept per input as a value at a point in time and evaluated
+ * lazily: it grows at idleSlope while the input is backlogged, is charged
+ * (idleSlope - datarate) * transmission time for every frame sent, and
+ * positive credit is lost when the queue runs empty. When no input is
+ * eligible, the time the first shaped input's credit reaches zero is
+ * computed in closed form and a single timer is scheduled for it, so the
+ * scheduler never polls.
+ */
+class INET_API CreditBasedScheduler : public SchedulerBase
+{
+  protected:
+    struct Shaper
+    {
+        double idleSlope = 0;       // bit/s, 0 for an unshaped input
+        double credit = 0;          // bits, valid from creditTime on
+        simtime_t creditTime;
+        bool backlogged = false;
+    };
+
+    std::vector<Shaper> shapers;
+    SerializationModel serialization;
+    cMessage *wakeTimer = nullptr;
+
+    // counters, recorded as scalars in finish()
+    long numSent = 0;
+    long numWakeups = 0;
+
+  public:
+    virtual ~CreditBasedScheduler();
+
+  protected:
+    virtual void initialize() override;
+    virtual void handleMessage(cMessage *msg) override;
+    virtual void finish() override;
+    virtual bool schedulePacket() override;
+    virtual void refreshDisplay() const override;
+
+    /** Credit of shaper at t, for t at or after its creditTime. */
+    double creditAt(const Shaper& shaper, simtime_t t) const;
+
+    /** Earliest time the backlogged shaper's credit is not negative. */
+    simtime_t eligibleTime(const Shaper& shaper) const;
+
+  public:
+    virtual void packetEnqueued(IPassiveQueue *inputQueue) override;
+};
+
+} // namespace inet
+
+#endif // ifndef __INET_CREDITBASEDSCHEDULER_H
@@ -25,12 +25,15 @@ Define_Module(DropTailQueue);
 
 simsignal_t DropTailQueue::queueLengthSignal = registerSignal("queueLength");
 
+DropTailQueue::~DropTailQueue()
+{
+    cancelAndDelete(snapshotTimer);
+}
+
 void DropTailQueue::initialize()
 {
     PassiveQueueBase::initialize();
 
-    queue.setName(par("queueName"));
-
     //statistics
     emit(queueLengthSignal, queue.getLength());
 
@@ -38,17 +41,71 @@ void DropTailQueue::initialize()
 
     // configuration
     frameCapacity = par("frameCapacity");
+    queue.setCapacity(frameCapacity);
+    byteCapacity = par("byteCapacity");
+    stats.initialize(par("statisticsInterval"), simTime(), 0);
+
+    // warm start
+    snapshotDir = par("snapshotDir").stdstringValue();
+    if (par("restoreSnapshot"))
+        restoreSnapshot();
+    double snapshotTime = par("snapshotTime");
+    if (snapshotTime >= 0) {
+        snapshotTimer = new cMessage("snapshot");
+        scheduleAt(snapshotTime, snapshotTimer);
+    }
+}
+
+void DropTailQueue::handleMessage(cMessage *msg)
+{
+    if (msg == snapshotTimer)
+        saveSnapshot();
+    else
+        PassiveQueueBase::handleMessage(msg);
+}
+
+void DropTailQueue::saveSnapshot()
+{
+    Snapshot snapshot(simTime());
+    for (int i = 0; i < queue.getLength(); i++)
+        snapshot.putPacket(queue.get(i), queue.getEnqueueTime(i));
+    snapshot.save(Snapshot::getFileName(this, snapshotDir.c_str()));
+}
+
+void DropTailQueue::restoreSnapshot()
+{
+    Snapshot snapshot(simTime());
+    snapshot.load(Snapshot::getFileName(this, snapshotDir.c_str()));
+    for (int i = 0; i < (int)snapshot.getPackets().size(); i++) {
+        // the same limits as enqueue()
+        simtime_t enqueueTime;
+        cPacket *packet = snapshot.createPacket(i, enqueueTime);
+        if ((frameCapacity && queue.getLength() >= frameCapacity)
+            || (byteCapacity && queue.getTotalByteLength() + packet->getByteLength() > byteCapacity))
+        {
+            delete packet;
+            throw cRuntimeError("Snapshot holds more packets than frameCapacity or more bytes than byteCapacity");
+        }
+        queue.insert(packet, enqueueTime);
+    }
+    queueLengthChanged();
 }
 
 cMessage *DropTailQueue::enqueue(cMessage *msg)
 {
-    if (frameCapacity && queue.getLength() >= frameCapacity) {
+    if ((frameCapacity && queue.getLength() >= frameCapacity)
+        || (byteCapacity && queue.getTotalByteLength() + check_and_cast<cPacket *>(msg)->getByteLength() > byteCapacity))
+    {
         EV << "Queue full, dropping packet.\n";
+        counters.tailDropped();
+        if (stats.isEnabled())
+            stats.dropped(simTime());
         return msg;
     }
     else {
-        queue.insert(msg);
-        emit(queueLengthSignal, queue.getLength());
+        queue.insert(msg, simTime());
+        counters.enqueued(queue.getLength(), queue.getTotalByteLength());
+        queueLengthChanged();
         return nullptr;
     }
 }
@@ -58,14 +115,33 @@ cMessage *DropTailQueue::dequeue()
     if (queue.isEmpty())
         return nullptr;
 
-    cMessage *msg = (cMessage *)queue.pop();
+    simtime_t enqueueTime = queue.frontEnqueueTime();
+    cMessage *msg = queue.pop();
 
     // statistics
-    emit(queueLengthSignal, queue.getLength());
+    counters.dequeued();
+    if (stats.isEnabled())
+        stats.sojournTime(simTime(), simTime() - enqueueTime);
+    queueLengthChanged();
 
     return msg;
 }
 
+void DropTailQueue::queueLengthChanged()
+{
+    if (stats.isEnabled())
+        stats.lengthChanged(simTime(), queue.getLength());
+    else
+        emit(queueLengthSignal, queue.getLength());
+}
+
+void DropTailQueue::finish()
+{
+    PassiveQueueBase::finish();
+    stats.recordScalars(this, simTime());
+    counters.recordScalars(this);
+}
+
 void DropTailQueue::sendOut(cMessage *msg)
 {
     send(msg, outGate);
@@ -76,5 +152,10 @@ bool DropTailQueue::isEmpty()
     return queue.isEmpty();
 }
 
+cMessage *DropTailQueue::getFirstMsg()
+{
+    return queue.front();
+}
+
 } // namespace inet
 
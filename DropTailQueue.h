@@ -21,27 +21,48 @@
 #include "inet/common/INETDefs.h"
 
 #include "inet/common/queue/PassiveQueueBase.h"
+#include "inet/common/queue/IQueueAccess.h"
+#include "inet/common/queue/IPeekableQueue.h"
+#include "inet/common/queue/PacketRing.h"
+#include "inet/common/queue/QueueStatistics.h"
+#include "inet/common/queue/QueueCounters.h"
+#include "inet/common/queue/Snapshot.h"
 
 namespace inet {
 
 /**
  * Drop-front queue. See NED for more info.
  */
-class INET_API DropTailQueue : public PassiveQueueBase
+class INET_API DropTailQueue : public PassiveQueueBase, public IQueueAccess, public IPeekableQueue
 {
   protected:
     // configuration
     int frameCapacity;
+    int byteCapacity;
 
     // state
-    cQueue queue;
+    PacketRing queue;
     cGate *outGate;
+    std::string snapshotDir;
+    cMessage *snapshotTimer = nullptr;
 
     // statistics
     static simsignal_t queueLengthSignal;
+    QueueStatistics stats; // replaces the per-packet signals when statisticsInterval >= 0
+    QueueCounters counters;
+
+  public:
+    virtual ~DropTailQueue();
 
   protected:
     virtual void initialize() override;
+    virtual void handleMessage(cMessage *msg) override;
+    virtual void finish() override;
+    void queueLengthChanged();
+
+    /** Writes the queued packets to the snapshot file. */
+    virtual void saveSnapshot();
+    virtual void restoreSnapshot();
 
     /**
      * Redefined from PassiveQueueBase.
@@ -62,6 +83,17 @@ class INET_API DropTailQueue : public PassiveQueueBase
      * Redefined from IPassiveQueue.
      */
     virtual bool isEmpty() override;
+
+  public:
+    virtual cMessage *getFirstMsg() override;
+
+    virtual int getLength() const override { return queue.getLength(); }
+
+    virtual int getByteLength() const override { return (int)queue.getTotalByteLength(); }
+
+    virtual int getPeekLength() const override { return queue.getLength(); }
+    virtual cMessage *getMsg(int i) const override { return queue.get(i); }
+    virtual int64_t getMsgByteLength(int i) const override { return queue.getByteLength(i); }
 };
 
 } // namespace inet
@@ -0,0 +1,236 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "inet/common/INETDefs.h"
+#include "inet/common/queue/DualPI2Queue.h"
+#include "inet/common/queue/ECNMarker.h"
+
+namespace inet {
+
+Define_Module(DualPI2Queue);
+
+simsignal_t DualPI2Queue::queueLengthSignal = registerSignal("queueLength");
+simsignal_t DualPI2Queue::lSojournTimeSignal = registerSignal("lSojournTime");
+simsignal_t DualPI2Queue::cSojournTimeSignal = registerSignal("cSojournTime");
+simsignal_t DualPI2Queue::baseProbabilitySignal = registerSignal("baseProbability");
+
+DualPI2Queue::~DualPI2Queue()
+{
+    cancelAndDelete(updateTimer);
+}
+
+void DualPI2Queue::initialize()
+{
+    PassiveQueueBase::initialize();
+
+    emit(queueLengthSignal, 0);
+    outGate = gate("out");
+
+    // configuration
+    frameCapacity = par("frameCapacity");
+    byteCapacity = par("byteCapacity");
+    lQueue.setCapacity(frameCapacity);
+    cQueue.setCapacity(frameCapacity);
+    target = simtime_t(par("target"));
+    tUpdate = simtime_t(par("tUpdate"));
+    if (tUpdate <= SIMTIME_ZERO)
+        throw cRuntimeError("tUpdate must be positive");
+    alpha = par("alpha").doubleValue() * tUpdate.dbl();
+    beta = par("beta").doubleValue() * tUpdate.dbl();
+    coupling = par("coupling");
+    stepThreshold = simtime_t(par("stepThreshold"));
+    timeShift = simtime_t(par("timeShift"));
+    maxClassicProb = par("maxClassicProb");
+    adapt = par("adapt").intValue() != 0;
+    simtime_t gate_period = simtime_t(par("gate_period"));
+    calendar = GateCalendar(gate_period.raw(), simtime_t(par("gate_rate") * gate_period).raw());
+
+    updateTimer = new cMessage("dualPI2Update");
+    stats.initialize(par("statisticsInterval"), simTime(), 0);
+}
+
+void DualPI2Queue::handleMessage(cMessage *msg)
+{
+    if (msg == updateTimer) {
+        updateProbability();
+        // nothing left to decay: sleep until the next arrival
+        if (!(isEmpty() && baseProbability == 0 && queueDelayOld == SIMTIME_ZERO))
+            scheduleAt(simTime() + tUpdate, updateTimer);
+    }
+    else
+        PassiveQueueBase::handleMessage(msg);
+}
+
+cMessage *DualPI2Queue::enqueue(cMessage *msg)
+{
+    cPacket *packet = check_and_cast<cPacket *>(msg);
+    if ((frameCapacity && getLength() >= frameCapacity)
+        || (byteCapacity && getByteLength() + packet->getByteLength() > byteCapacity))
+    {
+        EV << "Queue full, dropping packet.\n";
+        counters.tailDropped();
+        if (stats.isEnabled())
+            stats.dropped(simTime());
+        return msg;
+    }
+
+    PacketRing& queue = ECNMarker::isL4S(packet) ? lQueue : cQueue;
+    queue.insert(msg, simTime());
+    counters.enqueued(getLength(), getByteLength());
+    if (!updateTimer->isScheduled())
+        scheduleAt(simTime() + tUpdate, updateTimer);
+    if (stats.isEnabled())
+        stats.lengthChanged(simTime(), getLength());
+    else
+        emit(queueLengthSignal, getLength());
+    return nullptr;
+}
+
+cMessage *DualPI2Queue::dequeue()
+{
+    while (PacketRing *queue = selectQueue()) {
+        bool l4s = queue == &lQueue;
+        simtime_t enqueueTime = queue->frontEnqueueTime();
+        cPacket *packet = check_and_cast<cPacket *>(queue->pop());
+        simtime_t sojourn = sojournTime(enqueueTime, l4s ? lHeadCursor : cHeadCursor);
+
+        double classicProb = baseProbability * baseProbability;
+        bool drop = false;
+        if (l4s) {
+            if (classicProb > maxClassicProb && dblrand() < classicProb)
+                drop = true;    // overload: L4S traffic is not responding to marks
+            else if (sojourn >= stepThreshold || dblrand() < coupling * baseProbability) {
+                ECNMarker::markCE(packet);
+                numLMarks++;
+            }
+        }
+        else if (dblrand() < classicProb) {
+            if (classicProb <= maxClassicProb && ECNMarker::markCE(packet))
+                numCMarks++;
+            else
+                drop = true;
+        }
+
+        if (drop) {
+            EV << "DualPI2 drop from the " << (l4s ? "L4S" : "classic") << " queue (p'=" << baseProbability << ")\n";
+            numQueueDropped++;
+            numAqmDrops++;
+            emit(dropPkByQueueSignal, packet);
+            if (stats.isEnabled()) {
+                stats.dropped(simTime());
+                stats.lengthChanged(simTime(), getLength());
+            }
+            else
+                emit(queueLengthSignal, getLength());
+            delete packet;
+            continue;
+        }
+
+        counters.dequeued();
+        if (stats.isEnabled()) {
+            stats.sojournTime(simTime(), sojourn);
+            stats.lengthChanged(simTime(), getLength());
+        }
+        else {
+            emit(queueLengthSignal, getLength());
+            emit(l4s ? lSojournTimeSignal : cSojournTimeSignal, sojourn);
+        }
+        return packet;
+    }
+    return nullptr;
+}
+
+const PacketRing *DualPI2Queue::selectQueue() const
+{
+    if (lQueue.isEmpty())
+        return cQueue.isEmpty() ? nullptr : &cQueue;
+    if (cQueue.isEmpty())
+        return &lQueue;
+    // time-shifted FIFO: the L4S head is older once shifted by timeShift
+    return lQueue.frontEnqueueTime() - timeShift <= cQueue.frontEnqueueTime() ? &lQueue : &cQueue;
+}
+
+simtime_t DualPI2Queue::sojournTime(simtime_t enqueueTime, GateCalendar::Cursor& enqueueCursor)
+{
+    simtime_t now = simTime();
+    if (!adapt)
+        return now - enqueueTime;
+    calendar.seek(nowCursor, now.raw());
+    calendar.seek(enqueueCursor, enqueueTime.raw());
+    return SimTime().setRaw(calendar.openTimeBetween(enqueueCursor, enqueueTime.raw(), nowCursor, now.raw()));
+}
+
+/**
+ * RFC 9332 base PI update on the queueing delay of the classic head packet.
+ */
+void DualPI2Queue::updateProbability()
+{
+    simtime_t queueDelay;
+    if (!cQueue.isEmpty()) {
+        GateCalendar::Cursor cursor = cHeadCursor;
+        queueDelay = sojournTime(cQueue.frontEnqueueTime(), cursor);
+    }
+
+    baseProbability += alpha * (queueDelay - target).dbl() + beta * (queueDelay - queueDelayOld).dbl();
+    if (baseProbability < 0)
+        baseProbability = 0;
+    else if (baseProbability > 1)
+        baseProbability = 1;
+    queueDelayOld = queueDelay;
+
+    emit(baseProbabilitySignal, baseProbability);
+}
+
+void DualPI2Queue::finish()
+{
+    PassiveQueueBase::finish();
+    stats.recordScalars(this, simTime());
+    counters.recordScalars(this);
+    recordScalar("dropped:aqm", numAqmDrops);
+    recordScalar("marked:l4s", numLMarks);
+    recordScalar("marked:classic", numCMarks);
+}
+
+cMessage *DualPI2Queue::getFirstMsg()
+{
+    const PacketRing *queue = selectQueue();
+    return queue ? queue->front() : nullptr;
+}
+
+cMessage *DualPI2Queue::getMsg(int i) const
+{
+    ASSERT(i == 0);
+    const PacketRing *queue = selectQueue();
+    return queue ? queue->front() : nullptr;
+}
+
+int64_t DualPI2Queue::getMsgByteLength(int i) const
+{
+    ASSERT(i == 0);
+    const PacketRing *queue = selectQueue();
+    return queue ? queue->frontByteLength() : 0;
+}
+
+void DualPI2Queue::sendOut(cMessage *msg)
+{
+    send(msg, outGate);
+}
+
+bool DualPI2Queue::isEmpty()
+{
+    return lQueue.isEmpty() && cQueue.isEmpty();
+}
+
+} // namespace inet
@@ -0,0 +1,136 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef __INET_DUALPI2QUEUE_H
+#define __INET_DUALPI2QUEUE_H
+
+#include "inet/common/INETDefs.h"
+#include "inet/common/queue/PassiveQueueBase.h"
+#include "inet/common/queue/IQueueAccess.h"
+#include "inet/common/queue/IPeekableQueue.h"
+#include "inet/common/queue/GateCalendar.h"
+#include "inet/common/queue/PacketRing.h"
+#include "inet/common/queue/QueueStatistics.h"
+#include "inet/common/queue/QueueCounters.h"
+
+namespace inet {
+
+/**
+ * DualPI2 dual-queue coupled AQM (RFC 9332). Packets carrying ECT(1) or CE
+ * go to the L4S queue, all others to the classic queue; both share
+ * frameCapacity and byteCapacity.
+ *
+ * A PI controller updated every tUpdate drives a base probability p' from
+ * the classic queueing delay. Classic packets are dropped, or CE-marked if
+ * they are ECN-capable, with p' squared; L4S packets are marked with the
+ * coupled probability coupling * p', or always once their own sojourn
+ * time reaches stepThreshold. While the classic probability is above
+ * maxClassicProb the L4S queue is overloaded and drops with it as well.
+ * The queues are served by time-shifted FIFO: the L4S head goes first
+ * unless the classic head has waited timeShift longer.
+ *
+ * With adapt set, the AQM delays leave out the time spent behind the
+ * closed gate, as in CodelActiveQueue and PIEActiveQueue, so the module
+ * can be used as a GatedScheduler input.
+ */
+class INET_API DualPI2Queue : public PassiveQueueBase, public IQueueAccess, public IPeekableQueue
+{
+  protected:
+    // configuration
+    int frameCapacity;
+    int byteCapacity;
+    simtime_t target;
+    simtime_t tUpdate;
+    double alpha;               // per update, i.e. the Hz value times tUpdate
+    double beta;
+    double coupling;
+    simtime_t stepThreshold;
+    simtime_t timeShift;
+    double maxClassicProb;
+    bool adapt;
+    GateCalendar calendar;
+
+    // state
+    PacketRing lQueue;
+    PacketRing cQueue;
+    cGate *outGate;
+    cMessage *updateTimer = nullptr;
+    double baseProbability = 0; // p'
+    simtime_t queueDelayOld;
+    GateCalendar::Cursor nowCursor;
+    GateCalendar::Cursor lHeadCursor;
+    GateCalendar::Cursor cHeadCursor;
+
+    // statistics
+    static simsignal_t queueLengthSignal;
+    static simsignal_t lSojournTimeSignal;
+    static simsignal_t cSojournTimeSignal;
+    static simsignal_t baseProbabilitySignal;
+    QueueStatistics stats; // replaces the per-packet signals when statisticsInterval >= 0
+    QueueCounters counters;
+    long numLMarks = 0;
+    long numCMarks = 0;
+    long numAqmDrops = 0;
+
+  public:
+    DualPI2Queue() {}
+    virtual ~DualPI2Queue();
+
+  protected:
+    virtual void initialize() override;
+    virtual void handleMessage(cMessage *msg) override;
+    virtual void finish() override;
+
+    /**
+     * Redefined from PassiveQueueBase.
+     */
+    virtual cMessage *enqueue(cMessage *msg) override;
+
+    /**
+     * Redefined from PassiveQueueBase.
+     */
+    virtual cMessage *dequeue() override;
+
+    /**
+     * Redefined from PassiveQueueBase.
+     */
+    virtual void sendOut(cMessage *msg) override;
+
+    /**
+     * Redefined from IPassiveQueue.
+     */
+    virtual bool isEmpty() override;
+
+    /** Queueing delay from enqueueTime until now, without closed-gate time if adapt is set. */
+    simtime_t sojournTime(simtime_t enqueueTime, GateCalendar::Cursor& enqueueCursor);
+    virtual void updateProbability();
+
+    /** The queue the time-shifted FIFO serves next, nullptr if both are empty. */
+    const PacketRing *selectQueue() const;
+    PacketRing *selectQueue() { return const_cast<PacketRing *>(static_cast<const DualPI2Queue *>(this)->selectQueue()); }
+
+  public:
+    virtual int getLength() const override { return lQueue.getLength() + cQueue.getLength(); }
+    virtual int getByteLength() const override { return (int)(lQueue.getTotalByteLength() + cQueue.getTotalByteLength()); }
+    virtual cMessage *getFirstMsg() override;
+    virtual int getPeekLength() const override { return getLength() > 0 ? 1 : 0; }
+    virtual cMessage *getMsg(int i) const override;
+    virtual int64_t getMsgByteLength(int i) const override;
+    double getBaseProbability() const { return baseProbability; }
+};
+
+} // namespace inet
+
+#endif // ifndef __INET_DUALPI2QUEUE_H
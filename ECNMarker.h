@@ -0,0 +1,101 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef __INET_ECNMARKER_H
+#define __INET_ECNMARKER_H
+
+#include "inet/common/INETDefs.h"
+
+#ifdef WITH_IPv4
+#include "inet/networklayer/ipv4/IPv4Datagram.h"
+#endif // ifdef WITH_IPv4
+
+#ifdef WITH_IPv6
+#include "inet/networklayer/ipv6/IPv6Datagram.h"
+#endif // ifdef WITH_IPv6
+
+namespace inet {
+
+/**
+ * Reads and sets the ECN field (RFC 3168: the two low bits of the IPv4 ToS
+ * and the IPv6 traffic class) of the first IP datagram found in a packet's
+ * encapsulation chain, e.g. inside an EtherFrame. Packets without an IP
+ * datagram are Not-ECT.
+ */
+class INET_API ECNMarker
+{
+  public:
+    enum Codepoint {
+        NOT_ECT = 0,
+        ECT_1 = 1,      // L4S (RFC 9331)
+        ECT_0 = 2,
+        CE = 3
+    };
+
+    static Codepoint getCodepoint(cPacket *packet)
+    {
+        for (cPacket *p = packet; p; p = p->getEncapsulatedPacket()) {
+#ifdef WITH_IPv4
+            if (IPv4Datagram *datagram = dynamic_cast<IPv4Datagram *>(p))
+                return (Codepoint)(datagram->getTypeOfService() & 3);
+#endif // ifdef WITH_IPv4
+#ifdef WITH_IPv6
+            if (IPv6Datagram *datagram = dynamic_cast<IPv6Datagram *>(p))
+                return (Codepoint)(datagram->getTrafficClass() & 3);
+#endif // ifdef WITH_IPv6
+        }
+        return NOT_ECT;
+    }
+
+    static bool isECNCapable(cPacket *packet) { return getCodepoint(packet) != NOT_ECT; }
+
+    /** Whether the packet belongs to the L4S queue: ECT(1) or CE. */
+    static bool isL4S(cPacket *packet)
+    {
+        Codepoint codepoint = getCodepoint(packet);
+        return codepoint == ECT_1 || codepoint == CE;
+    }
+
+    /**
+     * Sets CE on an ECN-capable packet. Returns false, leaving the packet
+     * alone, if it is Not-ECT and has to be dropped instead.
+     */
+    static bool markCE(cPacket *packet)
+    {
+        for (cPacket *p = packet; p; p = p->getEncapsulatedPacket()) {
+#ifdef WITH_IPv4
+            if (IPv4Datagram *datagram = dynamic_cast<IPv4Datagram *>(p)) {
+                if ((datagram->getTypeOfService() & 3) == NOT_ECT)
+                    return false;
+                datagram->setTypeOfService(datagram->getTypeOfService() | CE);
+                return true;
+            }
+#endif // ifdef WITH_IPv4
+#ifdef WITH_IPv6
+            if (IPv6Datagram *datagram = dynamic_cast<IPv6Datagram *>(p)) {
+                if ((datagram->getTrafficClass() & 3) == NOT_ECT)
+                    return false;
+                datagram->setTrafficClass(datagram->getTrafficClass() | CE);
+                return true;
+            }
+#endif // ifdef WITH_IPv6
+        }
+        return false;
+    }
+};
+
+} // namespace inet
+
+#endif // ifndef __INET_ECNMARKER_H
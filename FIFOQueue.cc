@@ -29,16 +29,18 @@ simsignal_t FIFOQueue::queueLengthSignal = registerSignal("queueLength");
 void FIFOQueue::initialize()
 {
     PassiveQueueBase::initialize();
-    queue.setName(par("queueName"));
+    queue.setCapacity(0);
     outGate = gate("out");
+    stats.initialize(par("statisticsInterval"), simTime(), 0);
 }
 
 cMessage *FIFOQueue::enqueue(cMessage *msg)
 {
     cPacket *packet = check_and_cast<cPacket *>(msg);
-    queue.insert(packet);
+    queue.insert(packet, simTime());
     byteLength += packet->getByteLength();
-    emit(queueLengthSignal, queue.getLength());
+    counters.enqueued(queue.getLength(), byteLength);
+    queueLengthChanged();
     return nullptr;
 }
 
@@ -47,12 +49,31 @@ cMessage *FIFOQueue::dequeue()
     if (queue.isEmpty())
         return nullptr;
 
+    simtime_t enqueueTime = queue.frontEnqueueTime();
     cPacket *packet = check_and_cast<cPacket *>(queue.pop());
     byteLength -= packet->getByteLength();
-    emit(queueLengthSignal, queue.getLength());
+    counters.dequeued();
+    if (stats.isEnabled())
+        stats.sojournTime(simTime(), simTime() - enqueueTime);
+    queueLengthChanged();
     return packet;
 }
 
+void FIFOQueue::queueLengthChanged()
+{
+    if (stats.isEnabled())
+        stats.lengthChanged(simTime(), queue.getLength());
+    else
+        emit(queueLengthSignal, queue.getLength());
+}
+
+void FIFOQueue::finish()
+{
+    PassiveQueueBase::finish();
+    stats.recordScalars(this, simTime());
+    counters.recordScalars(this);
+}
+
 void FIFOQueue::sendOut(cMessage *msg)
 {
     send(msg, outGate);
@@ -63,5 +84,10 @@ bool FIFOQueue::isEmpty()
     return queue.isEmpty();
 }
 
+cMessage *FIFOQueue::getFirstMsg()
+{
+    return queue.front();
+}
+
 } // namespace inet
 
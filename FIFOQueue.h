@@ -22,28 +22,36 @@
 #include "inet/common/INETDefs.h"
 #include "inet/common/queue/PassiveQueueBase.h"
 #include "inet/common/queue/IQueueAccess.h"
+#include "inet/common/queue/IPeekableQueue.h"
+#include "inet/common/queue/PacketRing.h"
+#include "inet/common/queue/QueueStatistics.h"
+#include "inet/common/queue/QueueCounters.h"
 
 namespace inet {
 
 /**
  * Passive FIFO Queue with unlimited buffer space.
  */
-class INET_API FIFOQueue : public PassiveQueueBase, public IQueueAccess
+class INET_API FIFOQueue : public PassiveQueueBase, public IQueueAccess, public IPeekableQueue
 {
   protected:
     // state
-    cQueue queue;
+    PacketRing queue;
     cGate *outGate;
     int byteLength;
 
     // statistics
     static simsignal_t queueLengthSignal;
+    QueueStatistics stats; // replaces the per-packet signals when statisticsInterval >= 0
+    QueueCounters counters;
 
   public:
     FIFOQueue() : outGate(nullptr), byteLength(0) {}
 
   protected:
     virtual void initialize() override;
+    virtual void finish() override;
+    void queueLengthChanged();
 
     virtual cMessage *enqueue(cMessage *msg) override;
 
@@ -56,6 +64,13 @@ class INET_API FIFOQueue : public PassiveQueueBase, public IQueueAccess
     virtual int getLength() const override { return queue.getLength(); }
 
     virtual int getByteLength() const override { return byteLength; }
+
+  public:
+    virtual cMessage *getFirstMsg() override;
+
+    virtual int getPeekLength() const override { return queue.getLength(); }
+    virtual cMessage *getMsg(int i) const override { return queue.get(i); }
+    virtual int64_t getMsgByteLength(int i) const override { return queue.getByteLength(i); }
 };
 
 } // namespace inet
@@ -0,0 +1,442 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "inet/common/INETDefs.h"
+#include "inet/common/queue/FQCodelQueue.h"
+#include "inet/common/queue/ECNMarker.h"
+#include "inet/linklayer/ethernet/EtherFrame.h"
+
+#ifdef WITH_IPv4
+#include "inet/networklayer/ipv4/IPv4Datagram.h"
+#endif // ifdef WITH_IPv4
+
+#ifdef WITH_IPv6
+#include "inet/networklayer/ipv6/IPv6Datagram.h"
+#endif // ifdef WITH_IPv6
+
+#ifdef WITH_UDP
+#include "inet/transportlayer/udp/UDPPacket.h"
+#endif // ifdef WITH_UDP
+
+#ifdef WITH_TCP_COMMON
+#include "inet/transportlayer/tcp_common/TCPSegment.h"
+#endif // ifdef WITH_TCP_COMMON
+
+namespace inet {
+
+Define_Module(FQCodelQueue);
+
+/**
+ * Lets CodelCore::dequeue() pop and drop packets of one flow queue. The
+ * backlog CoDel checks against the MTU is that of the whole module, as in
+ * Linux; it reads 0 once the flow itself is empty, so CoDel never pops an
+ * empty flow.
+ */
+class FQCodelQueue::FlowView
+{
+  public:
+    struct Item
+    {
+        cMessage *msg;
+        simtime_t enqueueTime;
+    };
+
+  protected:
+    FQCodelQueue *owner;
+    Flow& flow;
+    simtime_t now;
+
+  public:
+    FlowView(FQCodelQueue *owner, Flow& flow) : owner(owner), flow(flow), now(simTime()) {}
+
+    Item pop()
+    {
+        Item item;
+        item.msg = owner->popPacket(flow, item.enqueueTime);
+        return item;
+    }
+
+    CodelCore::ticks_t enqueueTime(const Item& item) const { return item.enqueueTime.raw(); }
+
+    long backlog() const { return flow.length > 0 ? (long)owner->byteLength : 0; }
+
+    bool mark(Item& item) { return owner->useEcn && ECNMarker::markCE(check_and_cast<cPacket *>(item.msg)); }
+
+    void drop(const Item& item)
+    {
+        owner->numQueueDropped++;
+        owner->totalDropCount++;
+        owner->emit(dropPkByQueueSignal, item.msg);
+        if (owner->stats.isEnabled()) {
+            owner->stats.dropped(now);
+            owner->stats.lengthChanged(now, owner->length);
+        }
+        else {
+            owner->emit(queueLengthSignal, owner->length);
+            owner->emit(dropCountSignal, flow.codel.getCount());
+            owner->emit(dropSojournTimeSignal, now - item.enqueueTime);
+            owner->emit(totalDropCountSignal, owner->totalDropCount);
+        }
+        delete item.msg;
+    }
+};
+
+FQCodelQueue::~FQCodelQueue()
+{
+    for (auto msg : slotMessages)
+        delete msg;
+}
+
+void FQCodelQueue::initialize()
+{
+    // checked before CodelActiveQueue::initialize() can restore anything
+    // into the single queue that is emptied and shrunk below
+    if (par("restoreSnapshot") || par("snapshotTime").doubleValue() >= 0)
+        throw cRuntimeError("FQCodelQueue does not support warm-start snapshots (restoreSnapshot, snapshotTime)");
+    // enqueue() is replaced by the per-flow one, which has no admission check
+    if (simtime_t(par("admissionBound")) > SIMTIME_ZERO)
+        throw cRuntimeError("FQCodelQueue does not support admissionBound");
+    CodelActiveQueue::initialize();
+    queue.setCapacity(0); // packets are kept in the flow queues
+
+    numFlows = par("flows");
+    quantum = par("quantum");
+    if (numFlows <= 0)
+        throw cRuntimeError("Invalid number of flows %d", numFlows);
+    if (quantum <= 0)
+        throw cRuntimeError("Invalid quantum %d", quantum);
+
+    flows.resize(numFlows);
+    for (auto& flow : flows) {
+        flow.codel.setParameters(codel.getParameters());
+        flow.codel.reset();
+    }
+
+    growable = frameCapacity <= 0;
+    growPool(growable ? 64 : frameCapacity);
+}
+
+void FQCodelQueue::saveSnapshot()
+{
+    throw cRuntimeError("FQCodelQueue does not support warm-start snapshots");
+}
+
+void FQCodelQueue::restoreSnapshot()
+{
+    throw cRuntimeError("FQCodelQueue does not support warm-start snapshots");
+}
+
+/**
+ * Head drops and drop state time are summed over the flows; a flow's drop
+ * state time overlaps that of the others.
+ */
+void FQCodelQueue::finish()
+{
+    PassiveQueueBase::finish();
+    stats.recordScalars(this, simTime());
+    counters.recordScalars(this);
+    long headDrops = 0;
+    long marks = 0;
+    CodelCore::ticks_t dropStateTime = 0;
+    for (const auto& flow : flows) {
+        headDrops += flow.codel.getTotalDropCount();
+        marks += flow.codel.getTotalMarkCount();
+        dropStateTime += flow.codel.getDropStateTime(simTime().raw());
+    }
+    recordScalar("dropped:head", headDrops);
+    recordScalar("marked:ce", marks);
+    recordScalar("dropState:time", SimTime().setRaw(dropStateTime), "s");
+}
+
+int FQCodelQueue::classify(cPacket *packet) const
+{
+    uint64_t h = 0;
+    auto mix = [&h] (uint64_t v) {
+        h ^= v + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2);
+    };
+    for (cPacket *p = packet; p; p = p->getEncapsulatedPacket()) {
+        if (EtherFrame *frame = dynamic_cast<EtherFrame *>(p)) {
+            mix(frame->getSrc().getInt());
+            mix(frame->getDest().getInt());
+            continue;
+        }
+#ifdef WITH_IPv4
+        if (IPv4Datagram *datagram = dynamic_cast<IPv4Datagram *>(p)) {
+            mix(datagram->getSrcAddress().getInt());
+            mix(datagram->getDestAddress().getInt());
+            mix(datagram->getTransportProtocol());
+            continue;
+        }
+#endif // ifdef WITH_IPv4
+#ifdef WITH_IPv6
+        if (IPv6Datagram *datagram = dynamic_cast<IPv6Datagram *>(p)) {
+            const uint32_t *src = datagram->getSrcAddress().words();
+            const uint32_t *dest = datagram->getDestAddress().words();
+            for (int i = 0; i < 4; i++) {
+                mix(src[i]);
+                mix(dest[i]);
+            }
+            mix(datagram->getTransportProtocol());
+            continue;
+        }
+#endif // ifdef WITH_IPv6
+#ifdef WITH_UDP
+        if (UDPPacket *udpPacket = dynamic_cast<UDPPacket *>(p)) {
+            mix(udpPacket->getSourcePort());
+            mix(udpPacket->getDestinationPort());
+            break;
+        }
+#endif // ifdef WITH_UDP
+#ifdef WITH_TCP_COMMON
+        if (tcp::TCPSegment *segment = dynamic_cast<tcp::TCPSegment *>(p)) {
+            mix(segment->getSrcPort());
+            mix(segment->getDestPort());
+            break;
+        }
+#endif // ifdef WITH_TCP_COMMON
+    }
+    // final avalanche, then map onto [0, numFlows) without a division
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    return (int)(((h & 0xffffffffu) * (uint64_t)numFlows) >> 32);
+}
+
+cMessage *FQCodelQueue::enqueue(cMessage *msg)
+{
+    cPacket *packet = check_and_cast<cPacket *>(msg);
+    int64_t bytes = packet->getByteLength();
+    if (byteCapacity && bytes > byteCapacity) {
+        EV << "Packet larger than the queue, dropping packet.\n";
+        counters.tailDropped();
+        if (stats.isEnabled())
+            stats.dropped(simTime());
+        return msg;
+    }
+    // make room by dropping from the flow with the largest backlog
+    while ((frameCapacity && length >= frameCapacity) || (byteCapacity && byteLength + bytes > byteCapacity))
+        dropFromFattestFlow();
+
+    int index = classify(packet);
+    Flow& flow = flows[index];
+    pushPacket(flow, msg, bytes, simTime());
+    if (flow.list == NO_LIST) {
+        flow.deficit = quantum;
+        pushFlow(newFlows, index, NEW_LIST);
+    }
+    counters.enqueued(length, byteLength);
+
+    if (stats.isEnabled())
+        stats.lengthChanged(simTime(), length);
+    else
+        emit(queueLengthSignal, length);
+    return nullptr;
+}
+
+cMessage *FQCodelQueue::dequeue()
+{
+    while (true) {
+        FlowList *list = newFlows.head != -1 ? &newFlows : &oldFlows;
+        if (list->head == -1)
+            return nullptr;
+        int index = list->head;
+        Flow& flow = flows[index];
+
+        if (flow.deficit <= 0) {
+            flow.deficit += quantum;
+            popFlow(*list);
+            pushFlow(oldFlows, index, OLD_LIST);
+            continue;
+        }
+
+        if (flow.length == 0) {
+            popFlow(*list);
+            // an emptied new flow goes to the old list once, so it cannot
+            // regain new-flow priority by sending single packets
+            if (list == &newFlows && oldFlows.head != -1)
+                pushFlow(oldFlows, index, OLD_LIST);
+            else
+                flow.list = NO_LIST;
+            continue;
+        }
+
+        FlowView view(this, flow);
+        cMessage *msg = flow.codel.dequeue(simTime().raw(), view).msg;
+        flow.deficit -= (int)check_and_cast<cPacket *>(msg)->getByteLength();
+        counters.dequeued();
+
+        simtime_t sojournTime = SimTime().setRaw(flow.codel.getLastSojournTime());
+        if (stats.isEnabled()) {
+            stats.sojournTime(simTime(), sojournTime);
+            stats.lengthChanged(simTime(), length);
+        }
+        else {
+            emit(queueLengthSignal, length);
+            emit(virtualSojournDelaySignal, sojournTime);
+        }
+        return msg;
+    }
+}
+
+bool FQCodelQueue::isEmpty()
+{
+    return length == 0;
+}
+
+void FQCodelQueue::dropFromFattestFlow()
+{
+    Flow *fattest = nullptr;
+    for (auto& flow : flows)
+        if (!fattest || flow.byteLength > fattest->byteLength)
+            fattest = &flow;
+    ASSERT(fattest && fattest->length > 0);
+
+    simtime_t enqueueTime;
+    cMessage *msg = popPacket(*fattest, enqueueTime);
+    EV << "Queue full, dropping packet of the largest flow.\n";
+    counters.tailDrops++; // the arriving packet itself is still queued
+    numQueueDropped++;
+    totalDropCount++;
+    emit(dropPkByQueueSignal, msg);
+    if (stats.isEnabled())
+        stats.dropped(simTime());
+    delete msg;
+}
+
+/**
+ * The flow dequeue() would serve next, ignoring CoDel drops: the first
+ * backlogged flow in service order that needs the fewest deficit refills.
+ */
+const FQCodelQueue::Flow *FQCodelQueue::predictNextFlow() const
+{
+    const Flow *best = nullptr;
+    int bestRounds = 0;
+    for (const FlowList *list : { &newFlows, &oldFlows }) {
+        for (int i = list->head; i != -1; i = flows[i].listNext) {
+            const Flow& flow = flows[i];
+            if (flow.length == 0)
+                continue;
+            int rounds = flow.deficit > 0 ? 0 : (quantum - flow.deficit) / quantum;
+            if (rounds == 0)
+                return &flow;
+            if (!best || rounds < bestRounds) {
+                best = &flow;
+                bestRounds = rounds;
+            }
+        }
+    }
+    return best;
+}
+
+cMessage *FQCodelQueue::getFirstMsg()
+{
+    const Flow *flow = predictNextFlow();
+    return flow ? slotMessages[flow->head] : nullptr;
+}
+
+cMessage *FQCodelQueue::getMsg(int i) const
+{
+    ASSERT(i == 0);
+    const Flow *flow = predictNextFlow();
+    return flow ? slotMessages[flow->head] : nullptr;
+}
+
+int64_t FQCodelQueue::getMsgByteLength(int i) const
+{
+    ASSERT(i == 0);
+    const Flow *flow = predictNextFlow();
+    return flow ? slotByteLengths[flow->head] : 0;
+}
+
+void FQCodelQueue::growPool(int size)
+{
+    int oldSize = slotMessages.size();
+    slotMessages.resize(size, nullptr);
+    slotEnqueueTimes.resize(size);
+    slotByteLengths.resize(size, 0);
+    slotNext.resize(size, -1);
+    for (int i = size - 1; i >= oldSize; i--) {
+        slotNext[i] = freeSlot;
+        freeSlot = i;
+    }
+}
+
+void FQCodelQueue::pushPacket(Flow& flow, cMessage *msg, int64_t bytes, simtime_t enqueueTime)
+{
+    if (freeSlot == -1) {
+        if (!growable)
+            throw cRuntimeError("FQCodelQueue: packet pool exhausted");
+        growPool(2 * slotMessages.size());
+    }
+    int slot = freeSlot;
+    freeSlot = slotNext[slot];
+    slotMessages[slot] = msg;
+    slotEnqueueTimes[slot] = enqueueTime;
+    slotByteLengths[slot] = bytes;
+    slotNext[slot] = -1;
+    if (flow.tail == -1)
+        flow.head = slot;
+    else
+        slotNext[flow.tail] = slot;
+    flow.tail = slot;
+    flow.length++;
+    flow.byteLength += bytes;
+    length++;
+    byteLength += bytes;
+}
+
+cMessage *FQCodelQueue::popPacket(Flow& flow, simtime_t& enqueueTime)
+{
+    ASSERT(flow.length > 0);
+    int slot = flow.head;
+    cMessage *msg = slotMessages[slot];
+    enqueueTime = slotEnqueueTimes[slot];
+    flow.head = slotNext[slot];
+    if (flow.head == -1)
+        flow.tail = -1;
+    flow.length--;
+    flow.byteLength -= slotByteLengths[slot];
+    length--;
+    byteLength -= slotByteLengths[slot];
+    slotMessages[slot] = nullptr;
+    slotNext[slot] = freeSlot;
+    freeSlot = slot;
+    return msg;
+}
+
+void FQCodelQueue::pushFlow(FlowList& list, int index, ListId id)
+{
+    Flow& flow = flows[index];
+    flow.list = id;
+    flow.listNext = -1;
+    if (list.tail == -1)
+        list.head = index;
+    else
+        flows[list.tail].listNext = index;
+    list.tail = index;
+}
+
+int FQCodelQueue::popFlow(FlowList& list)
+{
+    int index = list.head;
+    list.head = flows[index].listNext;
+    if (list.head == -1)
+        list.tail = -1;
+    flows[index].listNext = -1;
+    return index;
+}
+
+} // namespace inet
+
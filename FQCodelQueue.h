@@ -0,0 +1,133 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef __INET_FQCODELQUEUE_H
+#define __INET_FQCODELQUEUE_H
+
+#include <vector>
+
+#include "inet/common/INETDefs.h"
+#include "inet/common/queue/CodelActiveQueue.h"
+
+namespace inet {
+
+/**
+ * FQ-CoDel (RFC 8290): packets are hashed into a fixed number of flow
+ * queues, each with its own CoDel state (including the gated adapt logic),
+ * served by deficit round robin with separate new-flow and old-flow lists.
+ * When the queue is full, the head of the flow with the largest byte
+ * backlog is dropped instead of the arriving packet.
+ *
+ * Flow state is allocated once in initialize(). Packets live in a shared
+ * slot pool with index-linked per-flow lists, so enqueue and dequeue do not
+ * allocate. Being a CodelActiveQueue, it can be used with GatedScheduler.
+ */
+class INET_API FQCodelQueue : public CodelActiveQueue
+{
+  protected:
+    class FlowView;
+
+    enum ListId { NO_LIST, NEW_LIST, OLD_LIST };
+
+    struct Flow
+    {
+        int head = -1;          // first packet slot
+        int tail = -1;
+        int length = 0;
+        int64_t byteLength = 0;
+        int deficit = 0;
+        int listNext = -1;      // next flow in the same new/old list
+        ListId list = NO_LIST;
+        CodelCore codel;
+    };
+
+    struct FlowList
+    {
+        int head = -1;
+        int tail = -1;
+    };
+
+    // configuration
+    int numFlows;
+    int quantum;
+
+    // flows and the packet slot pool
+    std::vector<Flow> flows;
+    FlowList newFlows;
+    FlowList oldFlows;
+    std::vector<cMessage *> slotMessages;
+    std::vector<simtime_t> slotEnqueueTimes;
+    std::vector<int64_t> slotByteLengths;
+    std::vector<int> slotNext;
+    int freeSlot = -1;
+    bool growable = true;
+    int length = 0;
+    int64_t byteLength = 0;
+    long totalDropCount = 0;
+
+  public:
+    FQCodelQueue() {}
+    virtual ~FQCodelQueue();
+
+  protected:
+    virtual void initialize() override;
+    virtual void finish() override;
+
+    /**
+     * Redefined from CodelActiveQueue: warm-start snapshots cover the
+     * single CoDel queue only, not the flow queues, and are rejected.
+     */
+    virtual void saveSnapshot() override;
+    virtual void restoreSnapshot() override;
+
+    /**
+     * Redefined from CodelActiveQueue.
+     */
+    virtual cMessage *enqueue(cMessage *msg) override;
+
+    /**
+     * Redefined from CodelActiveQueue.
+     */
+    virtual cMessage *dequeue() override;
+
+    /**
+     * Redefined from CodelActiveQueue.
+     */
+    virtual bool isEmpty() override;
+
+    virtual int classify(cPacket *packet) const;
+
+    // slot pool and flow lists
+    void growPool(int size);
+    void pushPacket(Flow& flow, cMessage *msg, int64_t bytes, simtime_t enqueueTime);
+    cMessage *popPacket(Flow& flow, simtime_t& enqueueTime);
+    void pushFlow(FlowList& list, int index, ListId id);
+    int popFlow(FlowList& list);
+    void dropFromFattestFlow();
+    const Flow *predictNextFlow() const;
+
+  public:
+    virtual int getLength() const override { return length; }
+    virtual int getByteLength() const override { return (int)byteLength; }
+    virtual cMessage *getFirstMsg() override;
+    virtual int getPeekLength() const override { return length > 0 ? 1 : 0; }
+    virtual cMessage *getMsg(int i) const override;
+    virtual int64_t getMsgByteLength(int i) const override;
+};
+
+} // namespace inet
+
+#endif // ifndef __INET_FQCODELQUEUE_H
+
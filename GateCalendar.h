@@ -0,0 +1,145 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef __INET_GATECALENDAR_H
+#define __INET_GATECALENDAR_H
+
+#include <cstdint>
+
+namespace inet {
+
+/**
+ * Gate-cycle arithmetic for a gate that is open during the first
+ * openDuration (gate_rate * gate_period) of every gate_period, starting at
+ * time 0. Used by CodelActiveQueue (through CodelCore) and GatedScheduler.
+ *
+ * Positions are kept in Cursor objects that follow a time value: moving a
+ * cursor forward or backward by a few cycles is done by stepping, so a
+ * cursor that tracks the current time (or the enqueue time of successive
+ * FIFO heads) costs O(1) per query without any division. Only a jump of
+ * more than MAX_STEPS cycles, e.g. after an idle period, falls back to one
+ * integer division. Cycle numbers are 64-bit.
+ *
+ * Times are raw simulation time ticks (SimTime::raw()).
+ */
+class GateCalendar
+{
+  public:
+    typedef int64_t ticks_t;
+
+    static const int MAX_STEPS = 4;
+
+    /**
+     * Position of a time value in the calendar: the cycle it falls into.
+     */
+    class Cursor
+    {
+        friend class GateCalendar;
+
+      protected:
+        int64_t cycle = 0;
+        ticks_t openTime = 0;
+
+      public:
+        int64_t getCycle() const { return cycle; }
+
+        /** Start of the cycle, i.e. the time the gate opened. */
+        ticks_t getOpenTime() const { return openTime; }
+    };
+
+  protected:
+    ticks_t period = 0;
+    ticks_t openDuration = 0;
+
+  public:
+    GateCalendar() {}
+    GateCalendar(ticks_t period, ticks_t openDuration) : period(period), openDuration(openDuration) {}
+
+    ticks_t getPeriod() const { return period; }
+    ticks_t getOpenDuration() const { return openDuration; }
+
+    /** Moves the cursor to the cycle containing t. No-op without a period. */
+    void seek(Cursor& cursor, ticks_t t) const
+    {
+        if (period <= 0)
+            return;
+        if (t >= cursor.openTime + period) {
+            if (t - cursor.openTime >= MAX_STEPS * period)
+                jump(cursor, t);
+            else {
+                do {
+                    cursor.openTime += period;
+                    cursor.cycle++;
+                } while (t >= cursor.openTime + period);
+            }
+        }
+        else if (t < cursor.openTime) {
+            if (cursor.openTime - t > MAX_STEPS * period)
+                jump(cursor, t);
+            else {
+                do {
+                    cursor.openTime -= period;
+                    cursor.cycle--;
+                } while (t < cursor.openTime);
+            }
+        }
+    }
+
+    /** Time the gate closes in the cursor's cycle. */
+    ticks_t getCloseTime(const Cursor& cursor) const { return cursor.openTime + openDuration; }
+
+    /** Time the gate opens again after the cursor's cycle. */
+    ticks_t getNextOpenTime(const Cursor& cursor) const { return cursor.openTime + period; }
+
+    /** Whether the gate is open at t, for a cursor already seeked to t. */
+    bool isOpen(const Cursor& cursor, ticks_t t) const { return t - cursor.openTime < openDuration; }
+
+    /**
+     * Sojourn time between t1 and t2 not spent behind the closed gate, as
+     * used by gated CoDel: the rest of t1's open window, every full open
+     * window in between and the time since t2's cycle opened. Both cursors
+     * must be seeked to their times; t1 <= t2.
+     */
+    ticks_t openTimeBetween(const Cursor& c1, ticks_t t1, const Cursor& c2, ticks_t t2) const
+    {
+        if (t1 >= c2.openTime)
+            return t2 - t1;
+        ticks_t open = (t2 - c2.openTime) + (c2.cycle - c1.cycle - 1) * openDuration;
+        ticks_t closeTime = getCloseTime(c1);
+        if (closeTime > t1)
+            open += closeTime - t1;
+        return open;
+    }
+
+    /** Time between t1 and t2 spent behind the closed gate. */
+    ticks_t blockedTimeBetween(const Cursor& c1, ticks_t t1, const Cursor& c2, ticks_t t2) const
+    {
+        return (t2 - t1) - openTimeBetween(c1, t1, c2, t2);
+    }
+
+  protected:
+    void jump(Cursor& cursor, ticks_t t) const
+    {
+        cursor.cycle = t / period;
+        if (t % period < 0)
+            cursor.cycle--; // round down for times before 0, e.g. restored from a snapshot
+        cursor.openTime = cursor.cycle * period;
+    }
+};
+
+} // namespace inet
+
+#endif // ifndef __INET_GATECALENDAR_H
+
@@ -0,0 +1,166 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef __INET_GATECONTROLLIST_H
+#define __INET_GATECONTROLLIST_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace inet {
+
+/**
+ * 802.1Qbv-style gate control list: a cycle of (duration, gate states)
+ * entries, repeated from time 0, with one gate per traffic class. Bit g of
+ * the gate states is set when gate g is open during the entry.
+ *
+ * For every entry and gate, the time until the gate closes (if it is open)
+ * or opens (if it is closed) is precomputed, taking the following entries
+ * and the wrap-around into account, so both queries are O(1) for a Cursor
+ * seeked to the current time. Like GateCalendar, cursors step forward
+ * entry by entry and fall back to a division after a jump of a cycle or
+ * more.
+ *
+ * Times are raw simulation time ticks (SimTime::raw()).
+ */
+class GateControlList
+{
+  public:
+    typedef int64_t ticks_t;
+
+    static const int MAX_GATES = 64;
+    static const ticks_t NEVER = INT64_MAX;
+
+    struct Entry
+    {
+        ticks_t duration;
+        uint64_t gateStates;
+    };
+
+    /**
+     * Position of a time value in the list: the entry it falls into.
+     */
+    class Cursor
+    {
+        friend class GateControlList;
+
+      protected:
+        size_t index = 0;
+        ticks_t entryStart = 0;
+
+      public:
+        size_t getIndex() const { return index; }
+        ticks_t getEntryStart() const { return entryStart; }
+    };
+
+  protected:
+    std::vector<Entry> entries;
+    int numGates = 0;
+    ticks_t cycleTime = 0;
+    std::vector<ticks_t> entryOffsets;  // start of each entry within the cycle
+    std::vector<ticks_t> closeOffsets;  // [entry * numGates + gate], from the entry start; NEVER if it never closes
+    std::vector<ticks_t> openOffsets;   // [entry * numGates + gate], 0 if open; NEVER if it never opens
+
+  public:
+    GateControlList() {}
+
+    /** Sets the entries; durations must be positive, numGates at most MAX_GATES. */
+    void setEntries(const std::vector<Entry>& entries, int numGates)
+    {
+        this->entries = entries;
+        this->numGates = numGates;
+        size_t n = entries.size();
+        cycleTime = 0;
+        entryOffsets.resize(n);
+        for (size_t k = 0; k < n; k++) {
+            entryOffsets[k] = cycleTime;
+            cycleTime += entries[k].duration;
+        }
+        closeOffsets.assign(n * numGates, ticks_t(NEVER));
+        openOffsets.assign(n * numGates, ticks_t(NEVER));
+        for (int g = 0; g < numGates; g++) {
+            // walk two cycles backwards so every entry sees its successors
+            ticks_t closeTime = NEVER;
+            ticks_t openTime = NEVER;
+            for (size_t j = 2 * n; j-- > 0; ) {
+                size_t k = j % n;
+                ticks_t start = entryOffsets[k] + (j >= n ? cycleTime : 0);
+                if (isOpenIn(k, g)) {
+                    openTime = start;
+                    if (j < n) {
+                        if (closeTime != NEVER)
+                            closeOffsets[k * numGates + g] = closeTime - start;
+                        openOffsets[k * numGates + g] = 0;
+                    }
+                }
+                else {
+                    closeTime = start;
+                    if (j < n && openTime != NEVER)
+                        openOffsets[k * numGates + g] = openTime - start;
+                }
+            }
+        }
+    }
+
+    bool isEmpty() const { return entries.empty(); }
+    int getNumGates() const { return numGates; }
+    ticks_t getCycleTime() const { return cycleTime; }
+    const std::vector<Entry>& getEntries() const { return entries; }
+
+    /** Moves the cursor to the entry containing t. */
+    void seek(Cursor& cursor, ticks_t t) const
+    {
+        if (entries.empty())
+            return;
+        if (t < cursor.entryStart || t - cursor.entryStart >= cycleTime) {
+            ticks_t cycleStart = t - t % cycleTime;
+            cursor.index = 0;
+            cursor.entryStart = cycleStart;
+        }
+        while (t >= cursor.entryStart + entries[cursor.index].duration) {
+            cursor.entryStart += entries[cursor.index].duration;
+            if (++cursor.index == entries.size())
+                cursor.index = 0;
+        }
+    }
+
+    bool isOpen(const Cursor& cursor, int gate) const { return isOpenIn(cursor.index, gate); }
+
+    /** Time gate closes after the cursor's position, NEVER if it is always open. */
+    ticks_t getCloseTime(const Cursor& cursor, int gate) const
+    {
+        ticks_t offset = closeOffsets[cursor.index * numGates + gate];
+        if (offset == NEVER)
+            return offset;
+        return cursor.entryStart + offset;
+    }
+
+    /** Time gate is open next, the entry start if it is open; NEVER if it never opens. */
+    ticks_t getOpenTime(const Cursor& cursor, int gate) const
+    {
+        ticks_t offset = openOffsets[cursor.index * numGates + gate];
+        if (offset == NEVER)
+            return offset;
+        return cursor.entryStart + offset;
+    }
+
+  protected:
+    bool isOpenIn(size_t entry, int gate) const { return (entries[entry].gateStates >> gate) & 1; }
+};
+
+} // namespace inet
+
+#endif // ifndef __INET_GATECONTROLLIST_H
@@ -16,60 +16,181 @@
 // along with this program; if not, see <http://www.gnu.org/licenses/>.
 //
 
+#include <algorithm>
+
 #include "inet/common/queue/GatedScheduler.h"
-#include "inet/linklayer/ethernet/EtherFrame.h"
-#include "inet/common/queue/CodelActiveQueue.h"
+#include "inet/common/queue/LinkDatarate.h"
+#include "inet/common/queue/PartitionCheck.h"
 
 namespace inet {
 
 Define_Module(GatedScheduler);
 
+// 802.3br: neither fragment of a preempted frame may be shorter than this
+static const int64_t MIN_FRAGMENT_LENGTH = 64;
+
 simsignal_t GatedScheduler::unvfgtTimeSignal = registerSignal("unvfgtTime");
 simsignal_t GatedScheduler::utilRateSignal = registerSignal("utilRate");
 simsignal_t GatedScheduler::outTimeSignal = registerSignal("outTime");
 
+GatedScheduler::~GatedScheduler() {
+    cancelAndDelete(gateOpenTimer);
+    cancelAndDelete(gateCloseTimer);
+    cancelAndDelete(snapshotTimer);
+}
+
 void GatedScheduler::initialize() {
+    checkLocalPeers(this);
     SchedulerBase::initialize();
     slot = par("slot");
     gate_period = simtime_t(par("gate_period"));
     gatetime = simtime_t(par("gate_rate") * gate_period); // 밪
+    calendar = GateCalendar(gate_period.raw(), gatetime.raw());
     gate = true;
     delayed_count = 0;
+    gateOpenTimer = new cMessage("gateOpen", 0);
+    gateCloseTimer = new cMessage("gateClose", 1);
+    batchMode = par("batchMode");
+    enqueueGenerations.assign(inputQueues.size(), 0);
+    double datarate = par("datarate");
+    if (datarate <= 0)
+        datarate = getLinkDatarate(this);
+    serialization = SerializationModel(SimTime::getScale(), datarate, par("frameOverhead"));
+    preemption = par("preemption");
+    fragmentOverhead = par("fragmentOverhead");
+    parseGateControlList(par("gateControlList"));
+
+    // warm start
+    snapshotDir = par("snapshotDir").stdstringValue();
+    if (par("restoreSnapshot"))
+        restoreSnapshot();
+    double snapshotTime = par("snapshotTime");
+    if (snapshotTime >= 0) {
+        snapshotTimer = new cMessage("snapshot");
+        scheduleAt(snapshotTime, snapshotTimer);
+    }
 }
 
 void GatedScheduler::handleMessage(cMessage *msg) {
-    if (msg->isSelfMessage()) { //    ƴ϶, is posted by scheduleAt
-        if (msg->getKind() == 0) { //    
-            if (packetsToBeRequestedFromInputs > 0) {
-                bool success = schedulePacket();
-                if (success) //requestPacket(),  slot < 0 ̸    ݺ
-                    packetsToBeRequestedFromInputs--;
-            } else if (packetsRequestedFromUs == 0)
-                notifyListeners();
-        } else { //   
-            emit(outTimeSignal, 0); // ƹ͵ 
-        }
-        msg->~cMessage();
+    if (msg == snapshotTimer) {
+        saveSnapshot();
+    } else if (msg == gateOpenTimer) { //    
+        if (packetsToBeRequestedFromInputs > 0) {
+            while (packetsToBeRequestedFromInputs > 0 && schedulePacket()) //requestPacket(),  slot < 0 ̸    ݺ
+                packetsToBeRequestedFromInputs--;
+        } else if (packetsRequestedFromUs == 0)
+            notifyListeners();
+    } else if (msg == gateCloseTimer) { //   
+        emit(outTimeSignal, 0); // the link is idle behind the closed gate
     } else { //  ̶
         ASSERT(packetsRequestedFromUs > 0);
         packetsRequestedFromUs--;
-        sendOut(msg);
-
-        cPacket *packet = dynamic_cast<cPacket *>(msg);
-        int64_t length = packet->getBitLength(); // Ŷ bit
-        double length4 = ((length + 3) / 4);
-        simtime_t duration = simtime_t(length4) / 25000000; // Ŷ µ ɸ ð
+        cPacket *packet = check_and_cast<cPacket *>(msg);
+        simtime_t duration = frameDuration(packet->getByteLength()); // Ŷ µ ɸ ð
+        simtime_t windowTime = duration; // the part that must end before the gate closes
+        if (headLength >= 0 && packet->getByteLength() == preemptedLength) {
+            // preempted: the head fragment fills this window and the tail
+            // fragment is sent first in the next one, each with fragmentOverhead
+            windowTime = frameDuration(headLength + fragmentOverhead);
+            duration = windowTime + frameDuration(packet->getByteLength() - headLength + fragmentOverhead);
+        } else if (headLength >= 0) {
+            // a head drop in the queue delivered another frame than the one
+            // preempt() decided on: it is sent whole, and the check below
+            // counts it if it overruns the gate
+            resumeUntil = SIMTIME_ZERO;
+        }
+        headLength = -1;
+        if (slot >= 0 && overrunsGate(msg->getArrivalGate()->getIndex(), windowTime)) {
+            numOverruns++;
+            EV_WARN << packet->getName() << " is still on the wire when the gate closes" << endl;
+        }
+        sendOut(packet);
         emit(outTimeSignal, duration); // durationŭ Ŷ 
-        cMessage *outendEvent = new cMessage("outend", 1); // Ŷ  ´ٴ ȣ,  CRC, SMD_C   , 1̸ , 0̸ ִ
-        scheduleAt(simTime() + duration, outendEvent);
+        numSent++;
+        busyTime += duration;
+        if (slot >= 0 && gcl.isEmpty() && !gateCloseTimer->isScheduled()) {
+            // one end-of-transmission mark per gate window instead of one per packet
+            calendar.seek(gateCursor, simTime().raw());
+            scheduleAt(SimTime().setRaw(gateCursor.getOpenTime()) + gatetime, gateCloseTimer);
+        }
+    }
+}
+
+/**
+ * True if a transmission of the given duration starting now does not lie
+ * entirely within an open window of the input's gate.
+ */
+bool GatedScheduler::overrunsGate(int input, simtime_t duration) {
+    simtime_t now = simTime();
+    if (!gcl.isEmpty()) {
+        gcl.seek(gclCursor, now.raw());
+        if (!gcl.isOpen(gclCursor, input))
+            return true;
+        GateControlList::ticks_t closeTime = gcl.getCloseTime(gclCursor, input);
+        return closeTime != GateControlList::NEVER && now.raw() + duration.raw() > closeTime;
     }
+    calendar.seek(gateCursor, now.raw());
+    simtime_t open_t = SimTime().setRaw(gateCursor.getOpenTime());
+    return now < open_t || now + duration > open_t + gatetime;
+}
+
+void GatedScheduler::finish() {
+    SchedulerBase::finish();
+    recordScalar("packets:out", numSent);
+    recordScalar("gateMisses", numGateMisses);
+    recordScalar("delayed", delayed_count);
+    recordScalar("preempted", numPreempted);
+    recordScalar("gateOverruns", numOverruns);
+    recordScalar("busyTime", busyTime, "s");
+}
+
+void GatedScheduler::saveSnapshot() {
+    Snapshot snapshot(simTime());
+    snapshot.put("gatetime", (int64_t)gatetime.raw()); // shrinks by the saved overrun
+    snapshot.put("gate", (int64_t)gate);
+    snapshot.putTime("resumeUntil", resumeUntil);
+    snapshot.putTimer("gateOpen", gateOpenTimer);
+    snapshot.putTimer("gateClose", gateCloseTimer);
+    snapshot.save(Snapshot::getFileName(this, snapshotDir.c_str()));
+}
+
+/**
+ * The request counters are not restored: the queues and the MAC request
+ * packets again when the restored run starts.
+ */
+void GatedScheduler::restoreSnapshot() {
+    Snapshot snapshot(simTime());
+    snapshot.load(Snapshot::getFileName(this, snapshotDir.c_str()));
+    gatetime.setRaw(snapshot.getInt("gatetime"));
+    gate = snapshot.getInt("gate") != 0;
+    resumeUntil = snapshot.getTime("resumeUntil");
+    simtime_t t = snapshot.getTimer("gateOpen");
+    if (t >= SIMTIME_ZERO)
+        scheduleGateOpen(t);
+    t = snapshot.getTimer("gateClose");
+    if (t >= SIMTIME_ZERO)
+        scheduleAt(t, gateCloseTimer);
+}
+
+void GatedScheduler::scheduleGateOpen(simtime_t t) {
+    if (gateOpenTimer->isScheduled()) {
+        if (gateOpenTimer->getArrivalTime() == t)
+            return;
+        cancelEvent(gateOpenTimer);
+    }
+    scheduleAt(t, gateOpenTimer);
 }
 
 bool GatedScheduler::schedulePacket() { // gate_period = 0.01s, gate_rate = 0.1
-    start: simtime_t current_t = simTime();
-    int a = current_t / gate_period; //  ð * 100
-    deqtime = current_t - gate_period * a; // dequeue  ð
-    simtime_t next_t = gate_period * (a + 1); //  dequeueð??
+    // a planned burst is released without looking at the calendar or the queues again
+    if (batchMode && slot >= 0 && gcl.isEmpty() && simTime() >= resumeUntil && releaseFromBurst())
+        return true;
+
+    simtime_t current_t = simTime();
+    calendar.seek(gateCursor, current_t.raw());
+    simtime_t open_t = SimTime().setRaw(gateCursor.getOpenTime());
+    deqtime = current_t - open_t; // dequeue  ð
+    simtime_t next_t = SimTime().setRaw(calendar.getNextOpenTime(gateCursor)); //  dequeueð??
     saved = 0;
 
     if (slot < 0) { // gated ƴϹǷ ǽð Ŷ ûѴ
@@ -81,19 +202,39 @@ bool GatedScheduler::schedulePacket() { // gate_period = 0.01s, gate_rate = 0.1
             }
         }
     } else { // gated 
+        if (!gcl.isEmpty())
+            return scheduleByGateControlList();
+        if (current_t < resumeUntil) {
+            // the tail fragment of a preempted frame occupies the start of
+            // the next window
+            gate = false;
+            scheduleGateOpen(resumeUntil);
+            return false;
+        }
+        if (batchMode && deqtime < gatetime) {
+            // no valid plan left: plan the rest of this window
+            planBurst();
+            if (releaseFromBurst())
+                return true;
+            // nothing fits: fall through to the blocking logic below
+        }
         for (auto inputQueue : inputQueues) { // inputQueues = object, inputQueue = name
             if (!inputQueue->isEmpty()) {
 
                 if (deqtime < gatetime) { // gated ð  ʾҴٸ, deqtime = current_t - gate_period * a;
                     gate = true; // gate 
-                    aqueue = check_and_cast<CodelActiveQueue *>(inputQueue);
-                    cMessage *msg = aqueue->getFirstMsg(); // queue ù° ޼  
-                    cPacket *packet = dynamic_cast<cPacket *>(msg); // queue  
-                    int64_t length = packet->getBitLength();
-                    double length4 = ((length + 3) / 4);
-                    simtime_t duration = simtime_t(length4) / 25000000;
+                    IPeekableQueue *peek = dynamic_cast<IPeekableQueue *>(inputQueue);
+                    if (!peek) { // cannot see the frame: no guard band
+                        inputQueue->requestPacket();
+                        return true;
+                    }
+                    int64_t byteLength = peek->getMsgByteLength(0); // only the head frame's length is needed
+                    simtime_t duration = frameDuration(byteLength);
                     if (deqtime + duration < gatetime) { // Ŷ  ð gate ִٸ
-                        aqueue->requestPacket(); // requestPacket ؾ dequeue ̷ Ŷ ۵
+                        inputQueue->requestPacket(); // requestPacket ؾ dequeue ̷ Ŷ ۵
+                        return true;
+                    } else if (preemption && preempt(byteLength, next_t)) {
+                        inputQueue->requestPacket();
                         return true;
                     } else if (inputQueues.back() == inputQueue) { //inputQueues  Ͱ   ٸ,   κ ľ
                         delayed_count++;
@@ -104,8 +245,7 @@ bool GatedScheduler::schedulePacket() { // gate_period = 0.01s, gate_rate = 0.1
                             saved = 0;
                             return false;
                         } else {
-                            int64_t newL = ((length + 99) / 4);
-                            simtime_t next = simtime_t(newL) / 25000000;
+                            simtime_t next = duration;
                             next_t = next_t + next;
                             saved = (deqtime + next) - gatetime;
                         }
@@ -117,8 +257,8 @@ bool GatedScheduler::schedulePacket() { // gate_period = 0.01s, gate_rate = 0.1
                 }
 
                 gate = false;
-                cMessage *delayEvent = new cMessage("delay", 0); //  segment ִ, ("message", kind)
-                scheduleAt(next_t, delayEvent); // next_t gated non_gated ϴ  
+                numGateMisses++;
+                scheduleGateOpen(next_t); // next_t gated non_gated ϴ  
                 return false;
 
             } // !queue.isEmpty() 
@@ -127,6 +267,175 @@ bool GatedScheduler::schedulePacket() { // gate_period = 0.01s, gate_rate = 0.1
     return false;
 }
 
+/**
+ * Parses the gateControlList parameter: whitespace separated
+ * <duration>:<gate states> entries, e.g. "2ms:10 8ms:01", where character
+ * i of the gate states is 1 if the gate of input i is open.
+ */
+void GatedScheduler::parseGateControlList(const char *spec) {
+    int numInputs = inputQueues.size();
+    std::vector<GateControlList::Entry> entries;
+    cStringTokenizer tokenizer(spec);
+    while (tokenizer.hasMoreTokens()) {
+        std::string token = tokenizer.nextToken();
+        size_t colon = token.find(':');
+        if (colon == std::string::npos)
+            throw cRuntimeError("Invalid gate control list entry '%s', expected <duration>:<gate states>", token.c_str());
+        GateControlList::Entry entry;
+        entry.duration = SimTime::parse(token.substr(0, colon).c_str()).raw();
+        if (entry.duration <= 0)
+            throw cRuntimeError("Gate control list entry '%s' must have a positive duration", token.c_str());
+        std::string states = token.substr(colon + 1);
+        if ((int)states.size() != numInputs)
+            throw cRuntimeError("Gate control list entry '%s' must have one gate state per input (%d)", token.c_str(), numInputs);
+        entry.gateStates = 0;
+        for (int i = 0; i < numInputs; i++) {
+            if (states[i] == '1')
+                entry.gateStates |= (uint64_t)1 << i;
+            else if (states[i] != '0')
+                throw cRuntimeError("Invalid gate state '%c' in gate control list entry '%s'", states[i], token.c_str());
+        }
+        entries.push_back(entry);
+    }
+    if (!entries.empty() && numInputs > GateControlList::MAX_GATES)
+        throw cRuntimeError("A gate control list supports at most %d inputs", GateControlList::MAX_GATES);
+    gcl.setEntries(entries, numInputs);
+}
+
+/**
+ * Strict priority among the inputs whose gate is open: the first non-empty
+ * one whose head frame ends before its gate closes is served. A frame that
+ * does not fit, or a closed gate, makes the input wait for its next
+ * opening, and the scheduler retries at the earliest such time. Inputs
+ * that are not IPeekableQueues are served without the guard band check.
+ */
+bool GatedScheduler::scheduleByGateControlList() {
+    simtime_t now = simTime();
+    gcl.seek(gclCursor, now.raw());
+    GateControlList::ticks_t wakeTime = GateControlList::NEVER;
+    for (int i = 0; i < (int)inputQueues.size(); i++) {
+        IPassiveQueue *inputQueue = inputQueues[i];
+        if (inputQueue->isEmpty())
+            continue;
+        if (!gcl.isOpen(gclCursor, i)) {
+            wakeTime = std::min(wakeTime, gcl.getOpenTime(gclCursor, i));
+            continue;
+        }
+        GateControlList::ticks_t closeTime = gcl.getCloseTime(gclCursor, i);
+        IPeekableQueue *peek = dynamic_cast<IPeekableQueue *>(inputQueue);
+        if (!peek || closeTime == GateControlList::NEVER
+                || now.raw() + frameDuration(peek->getMsgByteLength(0)).raw() < closeTime) {
+            gate = true;
+            inputQueue->requestPacket();
+            return true;
+        }
+        delayed_count++;
+        GateControlList::Cursor closeCursor = gclCursor;
+        gcl.seek(closeCursor, closeTime);
+        wakeTime = std::min(wakeTime, gcl.getOpenTime(closeCursor, i));
+    }
+    gate = false;
+    if (wakeTime != GateControlList::NEVER) {
+        numGateMisses++;
+        scheduleGateOpen(SimTime().setRaw(wakeTime));
+    }
+    return false;
+}
+
+/**
+ * Collects, in one pass over the input queues in priority order, the
+ * head-of-line packets that fit back to back into the rest of the current
+ * gate window. Stops at the first packet that does not fit, like the
+ * per-packet path does. Expects schedulePacket() to have set gateCursor
+ * and deqtime.
+ */
+void GatedScheduler::planBurst() {
+    burst.clear();
+    burstPos = 0;
+    burstEnd = SimTime().setRaw(gateCursor.getOpenTime()) + gatetime;
+    plannedGenerations = enqueueGenerations;
+    simtime_t end = simTime();
+    for (int input = 0; input < (int)inputQueues.size(); input++) {
+        IPassiveQueue *inputQueue = inputQueues[input];
+        IPeekableQueue *peek = dynamic_cast<IPeekableQueue *>(inputQueue);
+        if (!peek)
+            return;
+        int n = peek->getPeekLength();
+        for (int i = 0; i < n; i++) {
+            simtime_t duration = frameDuration(peek->getMsgByteLength(i));
+            if (end + duration >= burstEnd)
+                return;
+            end += duration;
+            burst.push_back(BurstEntry{inputQueue, peek, input, duration});
+        }
+    }
+}
+
+/**
+ * Requests the next packet of the planned burst, unless the plan no longer
+ * holds: a packet arrived in a higher priority input since planning (strict
+ * priority would serve it first), or the packet would not end before the
+ * gate closes because the requests came slower than back to back. If the
+ * queue drops packets at its head while serving the request, the packets
+ * planned behind it are gone and the plan is discarded.
+ */
+bool GatedScheduler::releaseFromBurst() {
+    if (burstPos == burst.size())
+        return false;
+    BurstEntry entry = burst[burstPos];
+    bool valid = simTime() + entry.duration < burstEnd;
+    for (int j = 0; valid && j < entry.input; j++)
+        valid = enqueueGenerations[j] == plannedGenerations[j];
+    if (!valid) {
+        burst.clear();
+        burstPos = 0;
+        return false;
+    }
+    int length = entry.peek->getPeekLength();
+    gate = true;
+    entry.queue->requestPacket();
+    burstPos++;
+    if (entry.peek->getPeekLength() != length - 1) {
+        burst.clear();
+        burstPos = 0;
+    }
+    return true;
+}
+
+void GatedScheduler::packetEnqueued(IPassiveQueue *inputQueue) {
+    for (size_t i = 0; i < inputQueues.size(); i++)
+        if (inputQueues[i] == inputQueue)
+            enqueueGenerations[i]++;
+    SchedulerBase::packetEnqueued(inputQueue);
+}
+
+/**
+ * Decides whether a frame of byteLength that does not fit into the rest of
+ * the window is preempted: its head fragment, headLength plus
+ * fragmentOverhead bytes, ends before the gate closes, and the tail
+ * fragment, the rest plus fragmentOverhead bytes, must fit into a whole
+ * window. Both fragments must be at least MIN_FRAGMENT_LENGTH long.
+ *
+ * Preemption is modelled in timing only: the frame is sent to the consumer
+ * once, and handleMessage() charges the link time of both fragments. The
+ * scheduler then waits until the tail fragment ends at resumeUntil.
+ */
+bool GatedScheduler::preempt(int64_t byteLength, simtime_t nextOpen) {
+    int64_t head = serialization.bytesIn((gatetime - deqtime).raw() - 1) - serialization.getOverhead() - fragmentOverhead;
+    if (head < MIN_FRAGMENT_LENGTH || byteLength - head < MIN_FRAGMENT_LENGTH
+            || frameDuration(byteLength - head + fragmentOverhead) >= gatetime)
+        return false;
+    simtime_t used = deqtime + frameDuration(head + fragmentOverhead);
+    headLength = head;
+    preemptedLength = byteLength;
+    resumeUntil = nextOpen + frameDuration(byteLength - head + fragmentOverhead);
+    numPreempted++;
+    gate = true;
+    emit(unvfgtTimeSignal, simtime_t(gatetime - used));
+    emit(utilRateSignal, used / gatetime);
+    return true;
+}
+
 void GatedScheduler::refreshDisplay() const {
     char buf[100];
     sprintf(buf, "gate: %s\nq delayed: %d\np req: %d", gate ? "open" : "close",
@@ -21,7 +21,11 @@
 
 #include "inet/common/INETDefs.h"
 #include "inet/common/queue/SchedulerBase.h"
-#include "inet/common/queue/CodelActiveQueue.h"
+#include "inet/common/queue/IPeekableQueue.h"
+#include "inet/common/queue/GateCalendar.h"
+#include "inet/common/queue/GateControlList.h"
+#include "inet/common/queue/SerializationModel.h"
+#include "inet/common/queue/Snapshot.h"
 
 namespace inet {
 
@@ -36,18 +40,75 @@ class INET_API GatedScheduler : public SchedulerBase
     simtime_t gate_period;
     simtime_t saved;
     bool gate;
-    CodelActiveQueue *aqueue;
+    GateCalendar calendar;
+    GateCalendar::Cursor gateCursor; // follows simTime()
+    GateControlList gcl;             // per-input gates; replaces gate_period/gate_rate if set
+    GateControlList::Cursor gclCursor;
+    SerializationModel serialization;
+    cMessage *gateOpenTimer = nullptr;
+    cMessage *gateCloseTimer = nullptr;
+    std::string snapshotDir;
+    cMessage *snapshotTimer = nullptr;
+
+    // batch mode: head-of-line packets that fit in the current gate window,
+    // released one per request without deciding again
+    struct BurstEntry
+    {
+        IPassiveQueue *queue;
+        IPeekableQueue *peek;
+        int input;
+        simtime_t duration;
+    };
+    bool batchMode = false;
+    std::vector<BurstEntry> burst;
+    size_t burstPos = 0;
+    simtime_t burstEnd;                         // gate close of the planned window
+    std::vector<uint64_t> enqueueGenerations;   // per input, counts arrivals
+    std::vector<uint64_t> plannedGenerations;   // enqueueGenerations when the burst was planned
+
+    // preemption mode: a frame that does not fit is split at the gate close
+    // and its tail fragment is sent first thing in the next window; the
+    // split is modelled in timing only, the frame itself is sent once
+    bool preemption = false;
+    int fragmentOverhead;       // bytes a fragment adds besides the per-frame overhead
+    int64_t headLength = -1;    // head fragment of the frame being requested, set by preempt()
+    int64_t preemptedLength = 0;    // length of that frame when preempt() saw it
+    simtime_t resumeUntil;      // end of the pending tail fragment
+    long numPreempted = 0;
+
+    // counters, recorded as scalars in finish()
+    long numSent = 0;
+    long numGateMisses = 0;     // requests deferred to the next gate opening
+    long numOverruns = 0;       // transmissions that go on past the gate close
+    simtime_t busyTime;         // transmission time of the packets sent
 
     static simsignal_t unvfgtTimeSignal;
     static simsignal_t utilRateSignal;
     static simsignal_t outTimeSignal;
 
+  public:
+    virtual ~GatedScheduler();
+
   protected:
     virtual void initialize() override;
     virtual void handleMessage(cMessage *msg) override;
+    virtual void finish() override;
     virtual bool schedulePacket() override;
     virtual void refreshDisplay() const override;
     bool schedulePacket(bool safe);
+    bool scheduleByGateControlList();
+    void parseGateControlList(const char *spec);
+    void scheduleGateOpen(simtime_t t);
+    void planBurst();
+    bool releaseFromBurst();
+    virtual void packetEnqueued(IPassiveQueue *inputQueue) override;
+    bool preempt(int64_t byteLength, simtime_t nextOpen);
+    bool overrunsGate(int input, simtime_t duration);
+
+    /** Writes the gate state and the pending gate timers to the snapshot file. */
+    virtual void saveSnapshot();
+    virtual void restoreSnapshot();
+    simtime_t frameDuration(int64_t byteLength) { return SimTime().setRaw(serialization.frameDuration(byteLength)); }
 };
 
 } // namespace inet
@@ -0,0 +1,47 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef __INET_IPEEKABLEQUEUE_H
+#define __INET_IPEEKABLEQUEUE_H
+
+#include "inet/common/INETDefs.h"
+
+namespace inet {
+
+/**
+ * Read-only view of the packets a passive queue will deliver next, used by
+ * GatedScheduler to check whether a frame fits into the open gate window
+ * before requesting it.
+ */
+class INET_API IPeekableQueue
+{
+  public:
+    virtual ~IPeekableQueue() {}
+
+    /** Packet the next dequeue() would deliver, ignoring AQM drops. */
+    virtual cMessage *getFirstMsg() = 0;
+
+    /** Number of packets whose dequeue order is known ahead. */
+    virtual int getPeekLength() const = 0;
+
+    /** The i-th packet in dequeue order, for i below getPeekLength(). */
+    virtual cMessage *getMsg(int i) const = 0;
+    virtual int64_t getMsgByteLength(int i) const = 0;
+};
+
+} // namespace inet
+
+#endif // ifndef __INET_IPEEKABLEQUEUE_H
+
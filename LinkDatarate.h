@@ -0,0 +1,62 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef __INET_LINKDATARATE_H
+#define __INET_LINKDATARATE_H
+
+#include "inet/common/INETDefs.h"
+
+namespace inet {
+
+/**
+ * Datarate of the link a scheduler's or queue's consumer, the MAC,
+ * transmits on; used when the module's own datarate parameter is not set.
+ * The "out" gate leads to the MAC without a channel, so the modules along
+ * the way are asked instead: a MAC by the transmission channel of its
+ * "phys$o" gate or its "txrate" parameter, and a scheduler between a queue
+ * and the MAC by its "datarate" parameter, else by the module behind its
+ * own "out" gate. Throws if none of them gives a datarate.
+ */
+inline double getLinkDatarate(cModule *module)
+{
+    cModule *consumer = module;
+    for (;;) {
+        cModule *next = consumer->gate("out")->getPathEndGate()->getOwnerModule();
+        if (next == consumer)
+            break;
+        consumer = next;
+        if (consumer->hasGate("phys$o")) {
+            cChannel *channel = consumer->gate("phys$o")->findTransmissionChannel();
+            if (channel)
+                return channel->getNominalDatarate();
+        }
+        const char *names[] = { "txrate", "datarate" };
+        for (const char *name : names) {
+            if (consumer->hasPar(name)) {
+                double datarate = consumer->par(name);
+                if (datarate > 0)
+                    return datarate;
+            }
+        }
+        if (!consumer->hasGate("out") || consumer->isGateVector("out"))
+            break;
+    }
+    throw cRuntimeError("Cannot determine the datarate of %s: %s has neither a transmission channel on phys$o nor a txrate or datarate parameter, set the datarate parameter",
+            module->getFullPath().c_str(), consumer->getFullPath().c_str());
+}
+
+} // namespace inet
+
+#endif // ifndef __INET_LINKDATARATE_H
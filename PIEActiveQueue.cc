@@ -0,0 +1,213 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "inet/common/INETDefs.h"
+#include "inet/common/queue/PIEActiveQueue.h"
+
+namespace inet {
+
+Define_Module(PIEActiveQueue);
+
+simsignal_t PIEActiveQueue::queueLengthSignal = registerSignal("queueLength");
+simsignal_t PIEActiveQueue::virtualSojournDelaySignal = registerSignal("virtualSojournDelay");
+simsignal_t PIEActiveQueue::dropProbabilitySignal = registerSignal("dropProbability");
+
+// RFC 8033: no early drop while the queue holds less than two mean-sized packets
+static const int64_t MEAN_PKTSIZE = 1500;
+
+PIEActiveQueue::~PIEActiveQueue()
+{
+    cancelAndDelete(updateTimer);
+}
+
+void PIEActiveQueue::initialize()
+{
+    PassiveQueueBase::initialize();
+
+    emit(queueLengthSignal, 0);
+    outGate = gate("out");
+
+    // configuration
+    frameCapacity = par("frameCapacity");
+    byteCapacity = par("byteCapacity");
+    queue.setCapacity(frameCapacity);
+    target = simtime_t(par("target"));
+    tUpdate = simtime_t(par("tUpdate"));
+    maxBurst = simtime_t(par("maxBurst"));
+    alpha = par("alpha");
+    beta = par("beta");
+    if (tUpdate <= SIMTIME_ZERO)
+        throw cRuntimeError("tUpdate must be positive");
+    adapt = par("adapt").intValue() != 0;
+    simtime_t gate_period = simtime_t(par("gate_period"));
+    calendar = GateCalendar(gate_period.raw(), simtime_t(par("gate_rate") * gate_period).raw());
+
+    burstAllowance = maxBurst;
+    updateTimer = new cMessage("pieUpdate");
+    stats.initialize(par("statisticsInterval"), simTime(), 0);
+}
+
+void PIEActiveQueue::handleMessage(cMessage *msg)
+{
+    if (msg == updateTimer) {
+        updateProbability();
+        // nothing left to decay: sleep until the next arrival
+        if (!(queue.isEmpty() && dropProbability == 0 && queueDelayOld == SIMTIME_ZERO))
+            scheduleAt(simTime() + tUpdate, updateTimer);
+    }
+    else
+        PassiveQueueBase::handleMessage(msg);
+}
+
+cMessage *PIEActiveQueue::enqueue(cMessage *msg)
+{
+    int64_t bytes = check_and_cast<cPacket *>(msg)->getByteLength();
+    if ((frameCapacity && queue.getLength() >= frameCapacity)
+        || (byteCapacity && queue.getTotalByteLength() + bytes > byteCapacity))
+    {
+        EV << "Queue full, dropping packet.\n";
+        counters.tailDropped();
+        if (stats.isEnabled())
+            stats.dropped(simTime());
+        return msg;
+    }
+
+    // RFC 8033 section 5.1 drop_early()
+    if (burstAllowance <= SIMTIME_ZERO
+        && !(queueDelayOld < target / 2 && dropProbability < 0.2)
+        && queue.getTotalByteLength() > 2 * MEAN_PKTSIZE
+        && dblrand() < dropProbability)
+    {
+        EV << "PIE early drop (p=" << dropProbability << ")\n";
+        counters.packetsIn++;
+        earlyDrops++;
+        if (stats.isEnabled())
+            stats.dropped(simTime());
+        return msg;
+    }
+
+    queue.insert(msg, simTime());
+    counters.enqueued(queue.getLength(), queue.getTotalByteLength());
+    if (!updateTimer->isScheduled())
+        scheduleAt(simTime() + tUpdate, updateTimer);
+    if (stats.isEnabled())
+        stats.lengthChanged(simTime(), queue.getLength());
+    else
+        emit(queueLengthSignal, queue.getLength());
+    return nullptr;
+}
+
+cMessage *PIEActiveQueue::dequeue()
+{
+    if (queue.isEmpty())
+        return nullptr;
+
+    simtime_t enqueueTime = queue.frontEnqueueTime();
+    cMessage *msg = queue.pop();
+    counters.dequeued();
+    simtime_t sojourn = sojournTime(enqueueTime, headCursor);
+    if (stats.isEnabled()) {
+        stats.sojournTime(simTime(), sojourn);
+        stats.lengthChanged(simTime(), queue.getLength());
+    }
+    else {
+        emit(queueLengthSignal, queue.getLength());
+        emit(virtualSojournDelaySignal, sojourn);
+    }
+    return msg;
+}
+
+simtime_t PIEActiveQueue::sojournTime(simtime_t enqueueTime, GateCalendar::Cursor& enqueueCursor)
+{
+    simtime_t now = simTime();
+    if (!adapt)
+        return now - enqueueTime;
+    calendar.seek(nowCursor, now.raw());
+    calendar.seek(enqueueCursor, enqueueTime.raw());
+    return SimTime().setRaw(calendar.openTimeBetween(enqueueCursor, enqueueTime.raw(), nowCursor, now.raw()));
+}
+
+/**
+ * RFC 8033 section 4.2 calculate_drop_prob(), with the delay of the
+ * current head packet as the queueing delay estimate.
+ */
+void PIEActiveQueue::updateProbability()
+{
+    if (queue.isEmpty())
+        queueDelay = SIMTIME_ZERO;
+    else {
+        GateCalendar::Cursor cursor = headCursor;
+        queueDelay = sojournTime(queue.frontEnqueueTime(), cursor);
+    }
+
+    double p = alpha * (queueDelay - target).dbl() + beta * (queueDelay - queueDelayOld).dbl();
+    // scale the step down while the probability is small
+    if (dropProbability < 0.000001)
+        p /= 2048;
+    else if (dropProbability < 0.00001)
+        p /= 512;
+    else if (dropProbability < 0.0001)
+        p /= 128;
+    else if (dropProbability < 0.001)
+        p /= 32;
+    else if (dropProbability < 0.01)
+        p /= 8;
+    else if (dropProbability < 0.1)
+        p /= 2;
+    else if (p > 0.02)
+        p = 0.02;
+    dropProbability += p;
+
+    // decay while the queue stays empty; below the smallest scaling step it
+    // is snapped to 0, as integer implementations do, so the timer can stop
+    if (queueDelay == SIMTIME_ZERO && queueDelayOld == SIMTIME_ZERO) {
+        dropProbability *= 0.98;
+        if (dropProbability < 0.000001)
+            dropProbability = 0;
+    }
+    if (dropProbability < 0)
+        dropProbability = 0;
+    else if (dropProbability > 1)
+        dropProbability = 1;
+
+    if (dropProbability == 0 && queueDelay < target / 2 && queueDelayOld < target / 2)
+        burstAllowance = maxBurst;
+    else if (burstAllowance > SIMTIME_ZERO)
+        burstAllowance = burstAllowance > tUpdate ? burstAllowance - tUpdate : SIMTIME_ZERO;
+    queueDelayOld = queueDelay;
+
+    emit(dropProbabilitySignal, dropProbability);
+}
+
+void PIEActiveQueue::finish()
+{
+    PassiveQueueBase::finish();
+    stats.recordScalars(this, simTime());
+    counters.recordScalars(this);
+    recordScalar("dropped:early", earlyDrops);
+}
+
+void PIEActiveQueue::sendOut(cMessage *msg)
+{
+    send(msg, outGate);
+}
+
+bool PIEActiveQueue::isEmpty()
+{
+    return queue.isEmpty();
+}
+
+} // namespace inet
+
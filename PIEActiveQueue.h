@@ -0,0 +1,117 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef __INET_PIEACTIVEQUEUE_H
+#define __INET_PIEACTIVEQUEUE_H
+
+#include "inet/common/INETDefs.h"
+#include "inet/common/queue/PassiveQueueBase.h"
+#include "inet/common/queue/IQueueAccess.h"
+#include "inet/common/queue/IPeekableQueue.h"
+#include "inet/common/queue/GateCalendar.h"
+#include "inet/common/queue/PacketRing.h"
+#include "inet/common/queue/QueueStatistics.h"
+#include "inet/common/queue/QueueCounters.h"
+
+namespace inet {
+
+/**
+ * PIE (RFC 8033) active queue. The drop probability is recomputed every
+ * tUpdate from the queueing delay of the head packet, so enqueue() costs a
+ * single comparison against it. With adapt set, the delay leaves out the
+ * time spent behind the closed gate, using the same gate_period/gate_rate
+ * schedule as CodelActiveQueue and GatedScheduler. The update timer stops
+ * while the queue is idle and the probability has decayed to 0.
+ */
+class INET_API PIEActiveQueue : public PassiveQueueBase, public IQueueAccess, public IPeekableQueue
+{
+  protected:
+    // configuration
+    int frameCapacity;
+    int byteCapacity;
+    simtime_t target;
+    simtime_t tUpdate;
+    simtime_t maxBurst;
+    double alpha;
+    double beta;
+    bool adapt;
+    GateCalendar calendar;
+
+    // state
+    PacketRing queue;
+    cGate *outGate;
+    cMessage *updateTimer = nullptr;
+    double dropProbability = 0;
+    simtime_t queueDelay;
+    simtime_t queueDelayOld;
+    simtime_t burstAllowance;
+    GateCalendar::Cursor nowCursor;
+    GateCalendar::Cursor headCursor;
+
+    // statistics
+    static simsignal_t queueLengthSignal;
+    static simsignal_t virtualSojournDelaySignal;
+    static simsignal_t dropProbabilitySignal;
+    QueueStatistics stats; // replaces the per-packet signals when statisticsInterval >= 0
+    QueueCounters counters;
+    long earlyDrops = 0;
+
+  public:
+    PIEActiveQueue() {}
+    virtual ~PIEActiveQueue();
+
+  protected:
+    virtual void initialize() override;
+    virtual void handleMessage(cMessage *msg) override;
+    virtual void finish() override;
+
+    /**
+     * Redefined from PassiveQueueBase.
+     */
+    virtual cMessage *enqueue(cMessage *msg) override;
+
+    /**
+     * Redefined from PassiveQueueBase.
+     */
+    virtual cMessage *dequeue() override;
+
+    /**
+     * Redefined from PassiveQueueBase.
+     */
+    virtual void sendOut(cMessage *msg) override;
+
+    /**
+     * Redefined from IPassiveQueue.
+     */
+    virtual bool isEmpty() override;
+
+    /** Queueing delay from enqueueTime until now, without closed-gate time if adapt is set. */
+    simtime_t sojournTime(simtime_t enqueueTime, GateCalendar::Cursor& enqueueCursor);
+    virtual void updateProbability();
+
+  public:
+    virtual int getLength() const override { return queue.getLength(); }
+    virtual int getByteLength() const override { return (int)queue.getTotalByteLength(); }
+    virtual cMessage *getFirstMsg() override { return queue.front(); }
+    virtual int getPeekLength() const override { return queue.getLength(); }
+    virtual cMessage *getMsg(int i) const override { return queue.get(i); }
+    virtual int64_t getMsgByteLength(int i) const override { return queue.getByteLength(i); }
+    double getDropProbability() const { return dropProbability; }
+};
+
+} // namespace inet
+
+#endif // ifndef __INET_PIEACTIVEQUEUE_H
+
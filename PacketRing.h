@@ -0,0 +1,144 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef __INET_PACKETRING_H
+#define __INET_PACKETRING_H
+
+#include <vector>
+
+#include "inet/common/INETDefs.h"
+
+namespace inet {
+
+/**
+ * FIFO packet storage for the passive queues. Slots are preallocated for
+ * the configured capacity; the enqueue time and byte length of each entry
+ * are kept in parallel arrays, so inserting and popping never allocate and
+ * the packets' own fields (e.g. the timestamp) are left untouched. The
+ * total byte length of the queued packets is kept as a running sum.
+ *
+ * A capacity of 0 means unlimited: the storage then doubles when full.
+ * Queued messages are owned by the module; the ring deletes the remaining
+ * ones when destroyed.
+ */
+class INET_API PacketRing
+{
+  protected:
+    std::vector<cMessage *> messages;
+    std::vector<simtime_t> enqueueTimes;
+    std::vector<int64_t> byteLengths;
+    int head = 0;
+    int length = 0;
+    int64_t totalByteLength = 0;
+    bool growable = true;
+
+  public:
+    PacketRing() {}
+    PacketRing(const PacketRing&) = delete;
+    PacketRing& operator=(const PacketRing&) = delete;
+    ~PacketRing() { clear(); }
+
+    /**
+     * Allocates storage for capacity packets, or makes the ring unlimited
+     * when capacity is 0. Must be called while the ring is empty.
+     */
+    void setCapacity(int capacity)
+    {
+        ASSERT(length == 0);
+        growable = capacity <= 0;
+        resize(growable ? 16 : capacity);
+    }
+
+    int getCapacity() const { return growable ? 0 : (int)messages.size(); }
+    int getLength() const { return length; }
+    bool isEmpty() const { return length == 0; }
+    bool isFull() const { return !growable && length == (int)messages.size(); }
+
+    /** Sum of the byte lengths of the queued packets. */
+    int64_t getTotalByteLength() const { return totalByteLength; }
+
+    void insert(cMessage *msg, simtime_t enqueueTime)
+    {
+        if (length == (int)messages.size()) {
+            if (!growable)
+                throw cRuntimeError("PacketRing: insert into full ring");
+            resize(messages.empty() ? 16 : 2 * messages.size());
+        }
+        int i = slot(length);
+        messages[i] = msg;
+        enqueueTimes[i] = enqueueTime;
+        cPacket *packet = dynamic_cast<cPacket *>(msg);
+        byteLengths[i] = packet ? packet->getByteLength() : 0;
+        totalByteLength += byteLengths[i];
+        length++;
+    }
+
+    cMessage *pop()
+    {
+        ASSERT(length > 0);
+        cMessage *msg = messages[head];
+        messages[head] = nullptr;
+        totalByteLength -= byteLengths[head];
+        if (++head == (int)messages.size())
+            head = 0;
+        length--;
+        return msg;
+    }
+
+    /** i-th entry from the head. */
+    cMessage *get(int i) const { return messages[slot(i)]; }
+    simtime_t getEnqueueTime(int i) const { return enqueueTimes[slot(i)]; }
+    int64_t getByteLength(int i) const { return byteLengths[slot(i)]; }
+
+    cMessage *front() const { return length > 0 ? messages[head] : nullptr; }
+    simtime_t frontEnqueueTime() const { return enqueueTimes[head]; }
+    int64_t frontByteLength() const { return byteLengths[head]; }
+
+    void clear()
+    {
+        while (length > 0)
+            delete pop();
+        head = 0;
+    }
+
+  protected:
+    int slot(int i) const
+    {
+        int j = head + i;
+        return j >= (int)messages.size() ? j - (int)messages.size() : j;
+    }
+
+    void resize(size_t size)
+    {
+        std::vector<cMessage *> newMessages(size, nullptr);
+        std::vector<simtime_t> newEnqueueTimes(size);
+        std::vector<int64_t> newByteLengths(size, 0);
+        for (int i = 0; i < length; i++) {
+            int j = slot(i);
+            newMessages[i] = messages[j];
+            newEnqueueTimes[i] = enqueueTimes[j];
+            newByteLengths[i] = byteLengths[j];
+        }
+        messages.swap(newMessages);
+        enqueueTimes.swap(newEnqueueTimes);
+        byteLengths.swap(newByteLengths);
+        head = 0;
+    }
+};
+
+} // namespace inet
+
+#endif // ifndef __INET_PACKETRING_H
+
@@ -0,0 +1,49 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef __INET_PARTITIONCHECK_H
+#define __INET_PARTITIONCHECK_H
+
+#include "inet/common/INETDefs.h"
+
+namespace inet {
+
+/**
+ * Parallel simulation support for the schedulers. A scheduler calls its
+ * input queues (requestPacket(), isEmpty(), IPeekableQueue) and is called
+ * by its consumer directly, which is only possible within one partition.
+ * Such modules must be placed together with the switch they belong to;
+ * partitions then communicate only over the links between switches, whose
+ * delays give the lookahead.
+ *
+ * checkLocalPeers() throws a clear error, instead of a failing cast in
+ * SchedulerBase, if a module at the other end of the scheduler's "in"
+ * gates or its "out" gate lives in another partition.
+ */
+inline void checkLocalPeers(cModule *scheduler)
+{
+    for (int i = 0; i < scheduler->gateSize("in"); i++) {
+        cModule *queue = scheduler->gate("in", i)->getPathStartGate()->getOwnerModule();
+        if (queue->isPlaceholder())
+            throw cRuntimeError("Input queue %s must be in the same partition as the scheduler", queue->getFullPath().c_str());
+    }
+    cModule *consumer = scheduler->gate("out")->getPathEndGate()->getOwnerModule();
+    if (consumer->isPlaceholder())
+        throw cRuntimeError("%s must be in the same partition as the scheduler", consumer->getFullPath().c_str());
+}
+
+} // namespace inet
+
+#endif // ifndef __INET_PARTITIONCHECK_H
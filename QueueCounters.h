@@ -0,0 +1,70 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef __INET_QUEUECOUNTERS_H
+#define __INET_QUEUECOUNTERS_H
+
+#include "inet/common/INETDefs.h"
+
+namespace inet {
+
+/**
+ * Run totals a queue keeps unconditionally: packets in and out, tail drops
+ * and the peak backlog. Each update is an increment or a compare, so the
+ * counters stay on when signals and vectors are not recorded; the owner
+ * writes them as scalars from finish().
+ */
+class INET_API QueueCounters
+{
+  public:
+    long packetsIn = 0;
+    long packetsOut = 0;
+    long tailDrops = 0;
+    int peakLength = 0;
+    int64_t peakByteLength = 0;
+
+  public:
+    /** A packet was queued; length and byteLength include it. */
+    void enqueued(int length, int64_t byteLength)
+    {
+        packetsIn++;
+        if (length > peakLength)
+            peakLength = length;
+        if (byteLength > peakByteLength)
+            peakByteLength = byteLength;
+    }
+
+    void dequeued() { packetsOut++; }
+
+    /** An arriving packet was refused because the queue was full. */
+    void tailDropped()
+    {
+        packetsIn++;
+        tailDrops++;
+    }
+
+    void recordScalars(cComponent *module) const
+    {
+        module->recordScalar("packets:in", packetsIn);
+        module->recordScalar("packets:out", packetsOut);
+        module->recordScalar("dropped:tail", tailDrops);
+        module->recordScalar("backlog:peak", peakLength);
+        module->recordScalar("backlog:peakBytes", (double)peakByteLength, "B");
+    }
+};
+
+} // namespace inet
+
+#endif // ifndef __INET_QUEUECOUNTERS_H
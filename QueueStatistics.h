@@ -0,0 +1,291 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef __INET_QUEUESTATISTICS_H
+#define __INET_QUEUESTATISTICS_H
+
+#include <vector>
+
+#include "inet/common/INETDefs.h"
+
+namespace inet {
+
+/**
+ * In-module statistics of a queue, used instead of emitting a signal per
+ * packet: time-weighted mean and maximum queue length, a log-bucketed
+ * sojourn time histogram with percentiles, and drop counts.
+ *
+ * With a positive interval the values of each interval are written to
+ * output vectors. The flush is lazy: it happens at the first update at or
+ * after the interval boundary and is timestamped with that boundary.
+ * Totals over the whole run are recorded as scalars by recordScalars(),
+ * which the owner calls from finish(). A negative interval disables the
+ * accumulator; the owner then emits its per-packet signals as before.
+ *
+ * Histogram buckets are exact below 16 ticks and split every power of two
+ * into 8 buckets above, so a percentile is off by at most 1/16 of its value.
+ */
+class INET_API QueueStatistics
+{
+  public:
+    static const int SUB_BUCKET_BITS = 3;
+    static const int NUM_BUCKETS = (64 - SUB_BUCKET_BITS) << SUB_BUCKET_BITS;
+
+  protected:
+    struct Window
+    {
+        simtime_t start;
+        double lengthArea = 0;      // integral of the queue length, in packet*s
+        int maxLength = 0;
+        long numSojourns = 0;
+        double sojournSum = 0;      // in s
+        long numDrops = 0;
+        std::vector<long> buckets;
+
+        void reset(simtime_t t, int length);
+    };
+
+    simtime_t interval = -1;
+    simtime_t nextFlush;
+    simtime_t lastChange;
+    int length = 0;
+    Window window;                  // current interval
+    Window total;                   // whole run
+
+    cOutVector *meanLengthVector = nullptr;
+    cOutVector *maxLengthVector = nullptr;
+    cOutVector *p50Vector = nullptr;
+    cOutVector *p99Vector = nullptr;
+    cOutVector *p999Vector = nullptr;
+    cOutVector *dropsVector = nullptr;
+
+  public:
+    QueueStatistics() {}
+    QueueStatistics(const QueueStatistics&) = delete;
+    QueueStatistics& operator=(const QueueStatistics&) = delete;
+    ~QueueStatistics();
+
+    /** Starts accumulating at now; a negative interval disables. */
+    void initialize(simtime_t interval, simtime_t now, int length);
+
+    bool isEnabled() const { return interval >= SIMTIME_ZERO; }
+
+    void lengthChanged(simtime_t now, int newLength);
+    void sojournTime(simtime_t now, simtime_t sojourn);
+    void dropped(simtime_t now);
+
+    /** Closes the run at now and records the totals as scalars of module. */
+    void recordScalars(cComponent *module, simtime_t now);
+
+    /** Sojourn time at quantile q (0..1) over the whole run. */
+    simtime_t getPercentile(double q) const { return percentile(total, q); }
+    double getMeanLength(simtime_t now) const;
+    long getNumDrops() const { return total.numDrops; }
+
+    static int bucketOf(int64_t ticks);
+    static int64_t bucketLowerBound(int bucket);
+    static int64_t bucketWidth(int bucket);
+
+  protected:
+    void advance(simtime_t now);
+    void flush(simtime_t boundary);
+    static simtime_t percentile(const Window& w, double q);
+};
+
+inline void QueueStatistics::Window::reset(simtime_t t, int length)
+{
+    start = t;
+    lengthArea = 0;
+    maxLength = length;
+    numSojourns = 0;
+    sojournSum = 0;
+    numDrops = 0;
+    buckets.assign(NUM_BUCKETS, 0);
+}
+
+inline QueueStatistics::~QueueStatistics()
+{
+    delete meanLengthVector;
+    delete maxLengthVector;
+    delete p50Vector;
+    delete p99Vector;
+    delete p999Vector;
+    delete dropsVector;
+}
+
+inline void QueueStatistics::initialize(simtime_t interval, simtime_t now, int length)
+{
+    this->interval = interval;
+    this->length = length;
+    lastChange = now;
+    window.reset(now, length);
+    total.reset(now, length);
+    if (interval > SIMTIME_ZERO) {
+        nextFlush = now + interval;
+        meanLengthVector = new cOutVector("queueLength:timeavg");
+        maxLengthVector = new cOutVector("queueLength:max");
+        p50Vector = new cOutVector("sojournTime:p50");
+        p99Vector = new cOutVector("sojournTime:p99");
+        p999Vector = new cOutVector("sojournTime:p999");
+        dropsVector = new cOutVector("dropped:count");
+    }
+}
+
+inline void QueueStatistics::lengthChanged(simtime_t now, int newLength)
+{
+    advance(now);
+    length = newLength;
+    if (length > window.maxLength)
+        window.maxLength = length;
+    if (length > total.maxLength)
+        total.maxLength = length;
+}
+
+inline void QueueStatistics::sojournTime(simtime_t now, simtime_t sojourn)
+{
+    advance(now);
+    int bucket = bucketOf(sojourn.raw());
+    window.buckets[bucket]++;
+    window.numSojourns++;
+    window.sojournSum += sojourn.dbl();
+    total.buckets[bucket]++;
+    total.numSojourns++;
+    total.sojournSum += sojourn.dbl();
+}
+
+inline void QueueStatistics::dropped(simtime_t now)
+{
+    advance(now);
+    window.numDrops++;
+    total.numDrops++;
+}
+
+inline double QueueStatistics::getMeanLength(simtime_t now) const
+{
+    simtime_t duration = now - total.start;
+    double area = total.lengthArea + length * (now - lastChange).dbl();
+    return duration > SIMTIME_ZERO ? area / duration.dbl() : length;
+}
+
+inline void QueueStatistics::recordScalars(cComponent *module, simtime_t now)
+{
+    if (!isEnabled())
+        return;
+    advance(now);
+    module->recordScalar("queueLength:timeavg", getMeanLength(now));
+    module->recordScalar("queueLength:max", total.maxLength);
+    module->recordScalar("sojournTime:count", total.numSojourns);
+    module->recordScalar("sojournTime:mean", total.numSojourns > 0 ? total.sojournSum / total.numSojourns : 0.0, "s");
+    module->recordScalar("sojournTime:p50", percentile(total, 0.5), "s");
+    module->recordScalar("sojournTime:p99", percentile(total, 0.99), "s");
+    module->recordScalar("sojournTime:p999", percentile(total, 0.999), "s");
+    module->recordScalar("dropped:count", total.numDrops);
+    for (int i = 0; i < NUM_BUCKETS; i++) {
+        if (total.buckets[i] > 0) {
+            std::string name = std::string("sojournTime:histogram ") + SimTime().setRaw(bucketLowerBound(i)).str();
+            module->recordScalar(name.c_str(), total.buckets[i]);
+        }
+    }
+}
+
+/**
+ * Integrates the queue length up to now, flushing the interval first if
+ * now reached its end. Idle intervals in between are merged into the one
+ * that is flushed, which keeps the time-weighted mean exact.
+ */
+inline void QueueStatistics::advance(simtime_t now)
+{
+    if (interval > SIMTIME_ZERO && now >= nextFlush) {
+        int64_t n = (now - nextFlush).raw() / interval.raw();
+        simtime_t boundary = nextFlush + interval * n;
+        double area = length * (boundary - lastChange).dbl();
+        window.lengthArea += area;
+        total.lengthArea += area;
+        lastChange = boundary;
+        flush(boundary);
+        nextFlush = boundary + interval;
+    }
+    double area = length * (now - lastChange).dbl();
+    window.lengthArea += area;
+    total.lengthArea += area;
+    lastChange = now;
+}
+
+inline void QueueStatistics::flush(simtime_t boundary)
+{
+    meanLengthVector->recordWithTimestamp(boundary, window.lengthArea / (boundary - window.start).dbl());
+    maxLengthVector->recordWithTimestamp(boundary, window.maxLength);
+    if (window.numSojourns > 0) {
+        p50Vector->recordWithTimestamp(boundary, percentile(window, 0.5));
+        p99Vector->recordWithTimestamp(boundary, percentile(window, 0.99));
+        p999Vector->recordWithTimestamp(boundary, percentile(window, 0.999));
+    }
+    dropsVector->recordWithTimestamp(boundary, window.numDrops);
+    window.reset(boundary, length);
+}
+
+inline simtime_t QueueStatistics::percentile(const Window& w, double q)
+{
+    if (w.numSojourns == 0)
+        return SIMTIME_ZERO;
+    long rank = (long)ceil(q * w.numSojourns);
+    if (rank < 1)
+        rank = 1;
+    long seen = 0;
+    for (int i = 0; i < NUM_BUCKETS; i++) {
+        seen += w.buckets[i];
+        if (seen >= rank)
+            return SimTime().setRaw(bucketLowerBound(i) + bucketWidth(i) / 2);
+    }
+    return SIMTIME_ZERO;
+}
+
+inline int QueueStatistics::bucketOf(int64_t ticks)
+{
+    if (ticks < (2 << SUB_BUCKET_BITS))
+        return ticks < 0 ? 0 : (int)ticks;
+    // position of the highest set bit, in six halving steps
+    uint64_t v = ticks;
+    int e = 0;
+    for (int shift = 32; shift > 0; shift >>= 1) {
+        if (v >> shift) {
+            v >>= shift;
+            e += shift;
+        }
+    }
+    return ((e - SUB_BUCKET_BITS + 1) << SUB_BUCKET_BITS) + (int)((ticks >> (e - SUB_BUCKET_BITS)) & ((1 << SUB_BUCKET_BITS) - 1));
+}
+
+inline int64_t QueueStatistics::bucketLowerBound(int bucket)
+{
+    if (bucket < (2 << SUB_BUCKET_BITS))
+        return bucket;
+    int e = (bucket >> SUB_BUCKET_BITS) + SUB_BUCKET_BITS - 1;
+    int64_t mantissa = (bucket & ((1 << SUB_BUCKET_BITS) - 1)) | (1 << SUB_BUCKET_BITS);
+    return mantissa << (e - SUB_BUCKET_BITS);
+}
+
+inline int64_t QueueStatistics::bucketWidth(int bucket)
+{
+    if (bucket < (2 << SUB_BUCKET_BITS))
+        return 1;
+    int e = (bucket >> SUB_BUCKET_BITS) + SUB_BUCKET_BITS - 1;
+    return (int64_t)1 << (e - SUB_BUCKET_BITS);
+}
+
+} // namespace inet
+
+#endif // ifndef __INET_QUEUESTATISTICS_H
+
@@ -0,0 +1,194 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef __INET_REDCORE_H
+#define __INET_REDCORE_H
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace inet {
+
+/**
+ * RED drop decision logic without any OMNeT++ dependency, shared by
+ * REDDropper and the aqmreplay tool.
+ *
+ * In fast mode the idle-time decay (1-wq)^m is read from tables built by
+ * setWeight() instead of calling pow(), and the random early drops follow
+ * Floyd's uniform variant: one uniform number R is drawn per drop
+ * interval, and the packet for which count * pb reaches R is dropped. The
+ * number of packets between drops is uniform in 1..1/pb as with the
+ * per-packet draw, but rng() is called once per drop instead of once per
+ * packet in the minth..maxth band.
+ */
+class REDCore
+{
+  public:
+    enum Verdict {
+        NO_DROP,
+        RANDOM_EARLY_DROP,
+        AVG_ABOVE_MAXTH,
+        QUEUE_ABOVE_MAXTH
+    };
+
+    /**
+     * Parameters and counters of one input gate, kept together so the
+     * state of all gates is one contiguous array.
+     */
+    struct Gate
+    {
+        double minth = 5;
+        double maxth = 50;
+        double maxp = 0.02;
+        double pkrate = 150;
+        double count = -1;
+        double dropThreshold = -1; // R of the current drop interval, fast mode only
+    };
+
+    /** Fraction steps per packet time in the fast decay table. */
+    static const int DECAY_FRACTION_STEPS = 256;
+
+    /** Longest idle period, in packet times, covered by the fast decay table. */
+    static const int MAX_DECAY_TABLE_SIZE = 65536;
+
+  protected:
+    double wq = 0.0;
+    double avg = 0.0;
+    double lastPb = 0.0;
+    bool fast = false;
+    std::vector<double> wholeDecay;     // (1-wq)^k
+    std::vector<double> fractionDecay;  // (1-wq)^(j/DECAY_FRACTION_STEPS)
+
+  public:
+    REDCore() {}
+
+    void setWeight(double weight, bool fastMode = false)
+    {
+        wq = weight;
+        fast = fastMode;
+        wholeDecay.clear();
+        fractionDecay.clear();
+        if (!fast)
+            return;
+        // (1-wq)^k is kept until it falls below 1e-15, after which the
+        // average is treated as decayed to 0
+        int size = MAX_DECAY_TABLE_SIZE;
+        if (wq >= 1.0)
+            size = 1;
+        else if (wq > 0.0)
+            size = (int)std::min((double)MAX_DECAY_TABLE_SIZE, std::ceil(std::log(1e-15) / std::log(1 - wq)) + 1);
+        wholeDecay.resize(size);
+        double factor = 1.0;
+        for (int k = 0; k < size; k++) {
+            wholeDecay[k] = factor;
+            factor *= 1 - wq;
+        }
+        fractionDecay.resize(DECAY_FRACTION_STEPS + 1);
+        for (int j = 0; j <= DECAY_FRACTION_STEPS; j++)
+            fractionDecay[j] = std::pow(1 - wq, (double)j / DECAY_FRACTION_STEPS);
+    }
+
+    double getWeight() const { return wq; }
+    bool isFast() const { return fast; }
+    double getAvg() const { return avg; }
+    void setAvg(double value) { avg = value; }
+
+    /** Drop probability computed by the last RANDOM_EARLY_DROP decision. */
+    double getLastPb() const { return lastPb; }
+
+    /**
+     * (1-wq)^m for an idle period of m packet times. Fast mode multiplies
+     * the whole-packet table entry with a linearly interpolated fraction
+     * entry; idle periods beyond the table fall back to pow().
+     */
+    double decay(double m) const
+    {
+        if (!fast || m < 0)
+            return std::pow(1 - wq, m);
+        if (m >= (double)wholeDecay.size())
+            return wholeDecay.size() < (size_t)MAX_DECAY_TABLE_SIZE ? 0.0 : std::pow(1 - wq, m);
+        int k = (int)m;
+        double f = (m - k) * DECAY_FRACTION_STEPS;
+        int j = (int)f;
+        double fraction = fractionDecay[j];
+        if (j < DECAY_FRACTION_STEPS)
+            fraction += (fractionDecay[j + 1] - fraction) * (f - j);
+        return wholeDecay[k] * fraction;
+    }
+
+    /**
+     * Updates the average queue length and decides about one arriving
+     * packet on the given gate. idleTime is the time in seconds since the
+     * queue went empty and is only used when queueLength is 0. rng() must
+     * return a uniform number in [0, 1) and is only called in the
+     * minth..maxth band.
+     */
+    template<typename Rng>
+    Verdict decide(int queueLength, double idleTime, Gate& gate, Rng& rng)
+    {
+        if (queueLength > 0) {
+            // TD: This following calculation is only useful when the queue is not empty!
+            avg = (1 - wq) * avg + wq * queueLength;
+        }
+        else {
+            // TD: Added behaviour for empty queue.
+            const double m = idleTime * gate.pkrate;
+            avg = decay(m) * avg;
+        }
+
+        if (gate.minth <= avg && avg < gate.maxth) {
+            gate.count++;
+            const double pb = gate.maxp * (avg - gate.minth) / (gate.maxth - gate.minth);
+            bool drop;
+            if (fast) {
+                if (gate.dropThreshold < 0)
+                    gate.dropThreshold = rng();
+                drop = gate.count * pb >= gate.dropThreshold;
+            }
+            else {
+                const double pa = pb / (1 - gate.count * pb); // TD: Adapted to work as in [Floyd93].
+                drop = rng() < pa;
+            }
+            if (drop) {
+                lastPb = pb;
+                gate.count = 0;
+                gate.dropThreshold = -1;
+                return RANDOM_EARLY_DROP;
+            }
+        }
+        else if (avg >= gate.maxth) {
+            gate.count = 0;
+            gate.dropThreshold = -1;
+            return AVG_ABOVE_MAXTH;
+        }
+        else if (queueLength >= gate.maxth) {    // maxth is also the "hard" limit
+            gate.count = 0;
+            gate.dropThreshold = -1;
+            return QUEUE_ABOVE_MAXTH;
+        }
+        else {
+            gate.count = -1;
+            gate.dropThreshold = -1;
+        }
+
+        return NO_DROP;
+    }
+};
+
+} // namespace inet
+
+#endif // ifndef __INET_REDCORE_H
+
@@ -18,6 +18,7 @@
 //
 
 #include "inet/common/queue/REDDropper.h"
+#include "inet/common/queue/ECNMarker.h"
 #include "inet/common/INETUtils.h"
 
 namespace inet {
@@ -26,116 +27,149 @@ Define_Module(REDDropper);
 
 REDDropper::~REDDropper()
 {
-    delete[] minths;
-    delete[] maxths;
-    delete[] maxps;
-    delete[] pkrates;
-    delete[] count;
-    q_time = 0;
+    cancelAndDelete(snapshotTimer);
 }
 
 void REDDropper::initialize()
 {
     AlgorithmicDropperBase::initialize();
 
-    wq = par("wq");
+    double wq = par("wq");
     if (wq < 0.0 || wq > 1.0)
         throw cRuntimeError("Invalid value for wq parameter: %g", wq);
+    red.setWeight(wq, par("fastMode"));
+    useEcn = par("useEcn");
 
-    minths = new double[numGates];
-    maxths = new double[numGates];
-    maxps = new double[numGates];
-    pkrates = new double[numGates];
-    count = new double[numGates];
+    gates.resize(numGates);
 
     cStringTokenizer minthTokens(par("minths"));
     cStringTokenizer maxthTokens(par("maxths"));
     cStringTokenizer maxpTokens(par("maxps"));
     cStringTokenizer pkrateTokens(par("pkrates"));
     for (int i = 0; i < numGates; ++i) {
-        minths[i] = minthTokens.hasMoreTokens() ? utils::atod(minthTokens.nextToken()) :
-            (i > 0 ? minths[i - 1] : 5.0);
-        maxths[i] = maxthTokens.hasMoreTokens() ? utils::atod(maxthTokens.nextToken()) :
-            (i > 0 ? maxths[i - 1] : 50.0);
-        maxps[i] = maxpTokens.hasMoreTokens() ? utils::atod(maxpTokens.nextToken()) :
-            (i > 0 ? maxps[i - 1] : 0.02);
-        pkrates[i] = pkrateTokens.hasMoreTokens() ? utils::atod(pkrateTokens.nextToken()) :
-            (i > 0 ? pkrates[i-1] : 150);
-        count[i] = -1;
-
-        if (minths[i] < 0.0)
+        REDCore::Gate& gate = gates[i];
+        gate.minth = minthTokens.hasMoreTokens() ? utils::atod(minthTokens.nextToken()) :
+            (i > 0 ? gates[i - 1].minth : 5.0);
+        gate.maxth = maxthTokens.hasMoreTokens() ? utils::atod(maxthTokens.nextToken()) :
+            (i > 0 ? gates[i - 1].maxth : 50.0);
+        gate.maxp = maxpTokens.hasMoreTokens() ? utils::atod(maxpTokens.nextToken()) :
+            (i > 0 ? gates[i - 1].maxp : 0.02);
+        gate.pkrate = pkrateTokens.hasMoreTokens() ? utils::atod(pkrateTokens.nextToken()) :
+            (i > 0 ? gates[i - 1].pkrate : 150);
+        gate.count = -1;
+
+        if (gate.minth < 0.0)
             throw cRuntimeError("minth parameter must not be negative");
-        if (maxths[i] < 0.0)
+        if (gate.maxth < 0.0)
             throw cRuntimeError("maxth parameter must not be negative");
-        if (minths[i] >= maxths[i])
+        if (gate.minth >= gate.maxth)
             throw cRuntimeError("minth must be smaller than maxth");
-        if (maxps[i] < 0.0 || maxps[i] > 1.0)
-            throw cRuntimeError("Invalid value for maxp parameter: %g", maxps[i]);
-        if (pkrates[i] < 0.0)
-            throw cRuntimeError("Invalid value for pkrates parameter: %g", pkrates[i]);
+        if (gate.maxp < 0.0 || gate.maxp > 1.0)
+            throw cRuntimeError("Invalid value for maxp parameter: %g", gate.maxp);
+        if (gate.pkrate < 0.0)
+            throw cRuntimeError("Invalid value for pkrates parameter: %g", gate.pkrate);
+    }
+
+    // warm start
+    snapshotDir = par("snapshotDir").stdstringValue();
+    if (par("restoreSnapshot"))
+        restoreSnapshot();
+    double snapshotTime = par("snapshotTime");
+    if (snapshotTime >= 0) {
+        snapshotTimer = new cMessage("snapshot");
+        scheduleAt(snapshotTime, snapshotTimer);
     }
 }
 
-bool REDDropper::shouldDrop(cPacket *packet)
+void REDDropper::handleMessage(cMessage *msg)
 {
-    const int i = packet->getArrivalGate()->getIndex();
-    ASSERT(i >= 0 && i < numGates);
-    const double minth = minths[i];
-    const double maxth = maxths[i];
-    const double maxp = maxps[i];
-    const double pkrate = pkrates[i];
-    const int queueLength = getLength();
+    if (msg == snapshotTimer)
+        saveSnapshot();
+    else
+        AlgorithmicDropperBase::handleMessage(msg);
+}
 
-    if (queueLength > 0)
-    {
-        // TD: This following calculation is only useful when the queue is not empty!
-        avg = (1 - wq) * avg + wq * queueLength;
+void REDDropper::saveSnapshot()
+{
+    Snapshot snapshot(simTime());
+    snapshot.put("avg", red.getAvg());
+    snapshot.putTime("q_time", q_time);
+    snapshot.put("numGates", (int64_t)numGates);
+    for (int i = 0; i < numGates; i++) {
+        snapshot.put(("count" + std::to_string(i)).c_str(), gates[i].count);
+        snapshot.put(("dropThreshold" + std::to_string(i)).c_str(), gates[i].dropThreshold);
     }
-    else
-    {
-        // TD: Added behaviour for empty queue.
-        const double m = SIMTIME_DBL(simTime() - q_time) * pkrate;
-        avg = pow(1 - wq, m) * avg;
+    snapshot.save(Snapshot::getFileName(this, snapshotDir.c_str()));
+}
+
+void REDDropper::restoreSnapshot()
+{
+    Snapshot snapshot(simTime());
+    snapshot.load(Snapshot::getFileName(this, snapshotDir.c_str()));
+    if (snapshot.getInt("numGates") != numGates)
+        throw cRuntimeError("Snapshot was taken with %d input gates, not %d", (int)snapshot.getInt("numGates"), numGates);
+    red.setAvg(snapshot.getDouble("avg"));
+    q_time = snapshot.getTime("q_time");
+    for (int i = 0; i < numGates; i++) {
+        gates[i].count = snapshot.getDouble(("count" + std::to_string(i)).c_str());
+        gates[i].dropThreshold = snapshot.getDouble(("dropThreshold" + std::to_string(i)).c_str());
     }
+}
 
-    if (minth <= avg && avg < maxth)
-    {
-        count[i]++;
-        const double pb = maxp * (avg - minth) / (maxth - minth);
-        const double pa = pb / (1 - count[i] * pb); // TD: Adapted to work as in [Floyd93].
-        if (dblrand() < pa)
-        {
-            EV << "Random early packet drop (avg queue len=" << avg << ", pa=" << pb << ")\n";
-            count[i] = 0;
+bool REDDropper::shouldDrop(cPacket *packet)
+{
+    const int i = packet->getArrivalGate()->getIndex();
+    ASSERT(i >= 0 && i < numGates);
+    const int queueLength = getLength();
+    const double idleTime = queueLength > 0 ? 0.0 : SIMTIME_DBL(simTime() - q_time);
+    auto rng = [this]() { return dblrand(); };
+    numArrived++;
+    if (queueLength > peakLength)
+        peakLength = queueLength;
+
+    switch (red.decide(queueLength, idleTime, gates[i], rng)) {
+        case REDCore::RANDOM_EARLY_DROP:
+            if (useEcn && ECNMarker::markCE(packet)) {
+                EV << "Random early packet mark (avg queue len=" << red.getAvg() << ", pa=" << red.getLastPb() << ")\n";
+                numEarlyMarks++;
+                return false;
+            }
+            EV << "Random early packet drop (avg queue len=" << red.getAvg() << ", pa=" << red.getLastPb() << ")\n";
+            numEarlyDrops++;
             return true;
-        }
-    }
-    else if (avg >= maxth) {
-        EV << "Avg queue len " << avg << " >= maxth, dropping packet.\n";
-        count[i] = 0;
-        return true;
-    }
-    else if (queueLength >= maxth) {    // maxth is also the "hard" limit
-        EV << "Queue len " << queueLength << " >= maxth, dropping packet.\n";
-        count[i] = 0;
-        return true;
-    }
-    else
-    {
-        count[i] = -1;
+        case REDCore::AVG_ABOVE_MAXTH:
+            EV << "Avg queue len " << red.getAvg() << " >= maxth, dropping packet.\n";
+            numForcedDrops++;
+            return true;
+        case REDCore::QUEUE_ABOVE_MAXTH:
+            EV << "Queue len " << queueLength << " >= maxth, dropping packet.\n";
+            numForcedDrops++;
+            return true;
+        default:
+            return false;
     }
-
-    return false;
 }
 
 void REDDropper::sendOut(cPacket *packet)
 {
     AlgorithmicDropperBase::sendOut(packet);
+    numPassed++;
     // TD: Set the time stamp q_time when the queue gets empty.
     const int queueLength = getLength();
     if (queueLength == 0)
         q_time = simTime();
 }
 
+void REDDropper::finish()
+{
+    AlgorithmicDropperBase::finish();
+    recordScalar("packets:in", numArrived);
+    recordScalar("packets:out", numPassed);
+    recordScalar("dropped:early", numEarlyDrops);
+    recordScalar("dropped:forced", numForcedDrops);
+    recordScalar("marked:early", numEarlyMarks);
+    recordScalar("backlog:peak", peakLength);
+}
+
 } // namespace inet
 
@@ -20,8 +20,12 @@
 #ifndef __INET_REDDROPPER_H
 #define __INET_REDDROPPER_H
 
+#include <vector>
+
 #include "inet/common/INETDefs.h"
 #include "inet/common/queue/AlgorithmicDropperBase.h"
+#include "inet/common/queue/REDCore.h"
+#include "inet/common/queue/Snapshot.h"
 
 namespace inet {
 
@@ -31,22 +35,34 @@ namespace inet {
 class INET_API REDDropper : public AlgorithmicDropperBase
 {
   protected:
-    double wq = 0.0;
-    double *minths = nullptr;
-    double *maxths = nullptr;
-    double *maxps = nullptr;
-    double *pkrates = nullptr;
-    double *count = nullptr;
-
-    double avg = 0.0;
+    REDCore red;
+    std::vector<REDCore::Gate> gates; // parameters and counters per input gate
+
     simtime_t q_time;
+    bool useEcn = false;       // mark ECN-capable packets instead of early drops
+    std::string snapshotDir;
+    cMessage *snapshotTimer = nullptr;
+
+    // counters, recorded as scalars in finish()
+    long numArrived = 0;
+    long numPassed = 0;
+    long numEarlyDrops = 0;    // random early drops
+    long numEarlyMarks = 0;    // random early drops turned into CE marks
+    long numForcedDrops = 0;   // average or instantaneous length at or above maxth
+    int peakLength = 0;        // queue length seen by an arriving packet
 
   public:
     REDDropper() {}
+    virtual ~REDDropper();
 
   protected:
-    virtual ~REDDropper();
     virtual void initialize() override;
+    virtual void handleMessage(cMessage *msg) override;
+    virtual void finish() override;
+
+    /** Writes avg, q_time and the per-gate counts to the snapshot file. */
+    virtual void saveSnapshot();
+    virtual void restoreSnapshot();
     virtual bool shouldDrop(cPacket *packet) override;
     virtual void sendOut(cPacket *packet) override;
 };
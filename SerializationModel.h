@@ -0,0 +1,90 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef __INET_SERIALIZATIONMODEL_H
+#define __INET_SERIALIZATIONMODEL_H
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace inet {
+
+/**
+ * Time a frame occupies the link at a given datarate, including a fixed
+ * per-frame overhead (for Ethernet, 8 bytes of preamble and SFD plus the
+ * 12 byte inter-frame gap). Durations are rounded up to whole ticks.
+ *
+ * Frame durations up to MAX_CACHED_LENGTH bytes are kept in a table that
+ * is filled the first time a length is seen, so the scheduler hot path is
+ * a single lookup; longer frames are computed each time.
+ *
+ * Times are raw simulation time ticks (SimTime::raw()); ticksPerSecond is
+ * SimTime::getScale().
+ */
+class SerializationModel
+{
+  public:
+    typedef int64_t ticks_t;
+
+    static const int ETHERNET_OVERHEAD = 20;
+    static const int MAX_CACHED_LENGTH = 10000;  // covers jumbo frames
+
+  protected:
+    int64_t ticksPerSecond = 0;
+    int64_t datarate = 0;       // bit/s
+    int overhead = 0;           // bytes per frame
+    std::vector<ticks_t> cache; // frame length in bytes -> duration, 0 if not computed yet
+
+  public:
+    SerializationModel() {}
+    SerializationModel(int64_t ticksPerSecond, double datarate, int overhead) :
+        ticksPerSecond(ticksPerSecond), datarate((int64_t)datarate), overhead(overhead),
+        cache(MAX_CACHED_LENGTH + 1, 0) {}
+
+    double getDatarate() const { return (double)datarate; }
+    int getOverhead() const { return overhead; }
+
+    /** Link time of a frame of byteLength, overhead included. */
+    ticks_t frameDuration(int64_t byteLength)
+    {
+        if (byteLength <= MAX_CACHED_LENGTH) {
+            ticks_t& duration = cache[byteLength];
+            if (duration == 0)
+                duration = bitDuration((byteLength + overhead) * 8);
+            return duration;
+        }
+        return bitDuration((byteLength + overhead) * 8);
+    }
+
+    /** Time to send bitLength bits, without any overhead. */
+    ticks_t bitDuration(int64_t bitLength) const
+    {
+        // exact while bitLength * ticksPerSecond fits into 63 bits, i.e. ~1MB at ps resolution
+        if (bitLength <= INT64_MAX / ticksPerSecond)
+            return (bitLength * ticksPerSecond + datarate - 1) / datarate;
+        return (ticks_t)std::ceil((double)bitLength * ticksPerSecond / datarate);
+    }
+
+    /** Whole bytes that can be sent in duration, without any overhead. */
+    int64_t bytesIn(ticks_t duration) const
+    {
+        return (int64_t)std::floor((double)duration * datarate / ticksPerSecond / 8 + 1e-9);
+    }
+};
+
+} // namespace inet
+
+#endif // ifndef __INET_SERIALIZATIONMODEL_H
@@ -0,0 +1,189 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef __INET_SNAPSHOT_H
+#define __INET_SNAPSHOT_H
+
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "inet/common/INETDefs.h"
+
+namespace inet {
+
+/**
+ * Warm-start snapshot of one module's state, kept as "key value" lines in
+ * <snapshotDir>/<module full path>.snap.
+ *
+ * Times are stored relative to the time the snapshot was taken and are
+ * restored relative to the time it is loaded, so a run restored at t=0
+ * continues where the warm-up run stood at the snapshot time. Gate
+ * calendars start at t=0 as well, so the snapshot time should be a
+ * multiple of the gate period to keep the gate phase.
+ *
+ * Queued packets are kept as descriptors (class, name, kind, byte length,
+ * timestamp, enqueue time) and re-created on restore; encapsulated packets
+ * and other fields are not preserved. Pending timers are kept as the time
+ * left until they fire.
+ */
+class INET_API Snapshot
+{
+  public:
+    /** Queued packet descriptor; the times are relative to the origin. */
+    struct Packet
+    {
+        std::string className;
+        std::string name;
+        short kind = 0;
+        int64_t byteLength = 0;
+        simtime_t timestamp;
+        simtime_t enqueueTime;
+    };
+
+  protected:
+    simtime_t origin;
+    std::map<std::string, std::string> values;
+    std::vector<Packet> packets;
+
+  public:
+    /** A snapshot taken, or restored, at origin. */
+    explicit Snapshot(simtime_t origin) : origin(origin) {}
+
+    static std::string getFileName(cModule *module, const char *dir)
+    {
+        std::string fileName = dir;
+        if (!fileName.empty() && fileName.back() != '/')
+            fileName += '/';
+        return fileName + module->getFullPath() + ".snap";
+    }
+
+    void put(const char *key, int64_t value) { values[key] = std::to_string(value); }
+    void put(const char *key, double value)
+    {
+        std::ostringstream os;
+        os.precision(17);
+        os << value;
+        values[key] = os.str();
+    }
+    void putTime(const char *key, simtime_t t) { put(key, (int64_t)(t - origin).raw()); }
+
+    /** Time left until the timer fires, or -1 if it is not scheduled. */
+    void putTimer(const char *key, cMessage *timer)
+    {
+        put(key, timer->isScheduled() ? (int64_t)(timer->getArrivalTime() - origin).raw() : (int64_t)-1);
+    }
+
+    void putPacket(cMessage *msg, simtime_t enqueueTime)
+    {
+        cPacket *packet = check_and_cast<cPacket *>(msg);
+        Packet descriptor;
+        descriptor.className = packet->getClassName();
+        descriptor.name = packet->getName();
+        descriptor.kind = packet->getKind();
+        descriptor.byteLength = packet->getByteLength();
+        descriptor.timestamp = packet->getTimestamp() - origin;
+        descriptor.enqueueTime = enqueueTime - origin;
+        packets.push_back(descriptor);
+    }
+
+    int64_t getInt(const char *key) const
+    {
+        auto it = values.find(key);
+        if (it == values.end())
+            throw cRuntimeError("Snapshot has no '%s' entry", key);
+        return std::stoll(it->second);
+    }
+    double getDouble(const char *key) const
+    {
+        auto it = values.find(key);
+        if (it == values.end())
+            throw cRuntimeError("Snapshot has no '%s' entry", key);
+        return std::stod(it->second);
+    }
+    simtime_t getTime(const char *key) const { return origin + SimTime().setRaw(getInt(key)); }
+
+    /** When a timer saved by putTimer() fires, or a negative time if it was not scheduled. */
+    simtime_t getTimer(const char *key) const
+    {
+        int64_t left = getInt(key);
+        return left < 0 ? SimTime(-1) : origin + SimTime().setRaw(left);
+    }
+
+    const std::vector<Packet>& getPackets() const { return packets; }
+
+    /** A new packet from the i-th descriptor; its enqueue time is shifted to the origin. */
+    cPacket *createPacket(int i, simtime_t& enqueueTime) const
+    {
+        const Packet& descriptor = packets[i];
+        cPacket *packet = check_and_cast<cPacket *>(createOne(descriptor.className.c_str()));
+        packet->setName(descriptor.name.c_str());
+        packet->setKind(descriptor.kind);
+        packet->setByteLength(descriptor.byteLength);
+        packet->setTimestamp(origin + descriptor.timestamp);
+        enqueueTime = origin + descriptor.enqueueTime;
+        return packet;
+    }
+
+    void save(const std::string& fileName) const
+    {
+        std::ofstream out(fileName.c_str());
+        if (!out)
+            throw cRuntimeError("Cannot open snapshot file '%s' for writing", fileName.c_str());
+        out << "scaleExp " << SimTime::getScaleExp() << "\n";
+        for (const auto& value : values)
+            out << value.first << " " << value.second << "\n";
+        for (const auto& packet : packets)
+            out << "packet " << packet.enqueueTime.raw() << " " << packet.timestamp.raw() << " "
+                << packet.byteLength << " " << packet.kind << " " << packet.className << " " << packet.name << "\n";
+        if (!out)
+            throw cRuntimeError("Cannot write snapshot file '%s'", fileName.c_str());
+    }
+
+    void load(const std::string& fileName)
+    {
+        std::ifstream in(fileName.c_str());
+        if (!in)
+            throw cRuntimeError("Cannot open snapshot file '%s'", fileName.c_str());
+        std::string line;
+        while (std::getline(in, line)) {
+            std::istringstream is(line);
+            std::string key;
+            is >> key;
+            if (key == "packet") {
+                Packet packet;
+                int64_t enqueueTime, timestamp;
+                is >> enqueueTime >> timestamp >> packet.byteLength >> packet.kind >> packet.className;
+                if (!is)
+                    throw cRuntimeError("Invalid packet line in snapshot file '%s'", fileName.c_str());
+                is.get();   // the separator; the name is the rest of the line
+                std::getline(is, packet.name);
+                packet.enqueueTime.setRaw(enqueueTime);
+                packet.timestamp.setRaw(timestamp);
+                packets.push_back(packet);
+            }
+            else if (!key.empty())
+                is >> values[key];
+        }
+        if (getInt("scaleExp") != SimTime::getScaleExp())
+            throw cRuntimeError("Snapshot file '%s' was written with a different simtime-scale", fileName.c_str());
+    }
+};
+
+} // namespace inet
+
+#endif // ifndef __INET_SNAPSHOT_H
@@ -0,0 +1,125 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <chrono>
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+#include "inet/common/INETDefs.h"
+#include "inet/common/queue/IPassiveQueue.h"
+#include "inet/common/queue/benchmarks/BenchSource.h"
+
+namespace inet {
+
+/**
+ * Consumer of the queue benchmarks: requests packets from the passive
+ * queue or scheduler in front of it, serves them at a fixed datarate,
+ * forwards them if its output is connected, and reports the cost of the
+ * run at finish(). See NED for more info.
+ */
+class INET_API BenchServer : public cSimpleModule
+{
+  protected:
+    double datarate = 0;
+    IPassiveQueue *queue = nullptr;
+    cMessage *serviceTimer = nullptr;
+    long numServed = 0;
+    std::chrono::steady_clock::time_point startTime;
+
+  public:
+    BenchServer() {}
+    virtual ~BenchServer() { cancelAndDelete(serviceTimer); }
+
+  protected:
+    virtual void initialize() override;
+    virtual void handleMessage(cMessage *msg) override;
+    virtual void finish() override;
+    long getNumGenerated() const;
+};
+
+Define_Module(BenchServer);
+
+void BenchServer::initialize()
+{
+    datarate = par("datarate");
+    queue = check_and_cast<IPassiveQueue *>(gate("in")->getPathStartGate()->getOwnerModule());
+    serviceTimer = new cMessage("serviceDone");
+    startTime = std::chrono::steady_clock::now();
+    queue->requestPacket();
+}
+
+void BenchServer::handleMessage(cMessage *msg)
+{
+    if (msg == serviceTimer) {
+        queue->requestPacket();
+        return;
+    }
+    cPacket *packet = check_and_cast<cPacket *>(msg);
+    numServed++;
+    scheduleAt(simTime() + packet->getBitLength() / datarate, serviceTimer);
+    if (gate("out")->isPathOK())
+        send(packet, "out");    // on to the next switch; the last switch's out is dangling
+    else
+        delete packet;
+}
+
+long BenchServer::getNumGenerated() const
+{
+    long numGenerated = 0;
+    for (cModule::SubmoduleIterator it(getParentModule()); !it.end(); it++)
+        if (BenchSource *source = dynamic_cast<BenchSource *>(*it))
+            numGenerated += source->getNumGenerated();
+    return numGenerated;
+}
+
+void BenchServer::finish()
+{
+    double wallTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    long numGenerated = getNumGenerated();
+    int64_t numEvents = getSimulation()->getEventNumber();
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    long peakRss = usage.ru_maxrss; // kB on Linux
+
+    double nsPerPacket = numGenerated > 0 ? wallTime * 1e9 / numGenerated : 0;
+    double eventsPerSecond = wallTime > 0 ? numEvents / wallTime : 0;
+    recordScalar("bench:packets", numGenerated);
+    recordScalar("bench:served", numServed);
+    recordScalar("bench:wallTime", wallTime, "s");
+    recordScalar("bench:nsPerPacket", nsPerPacket, "ns");
+    recordScalar("bench:eventsPerSecond", eventsPerSecond);
+    recordScalar("bench:peakRss", peakRss * 1024.0, "B");
+
+    // one CSV row per run, header written when the file is new
+    const char *benchmark = par("benchmark").stringValue();
+    const char *resultFile = par("resultFile").stringValue();
+    if (*resultFile) {
+        struct stat st;
+        bool exists = stat(resultFile, &st) == 0 && st.st_size > 0;
+        FILE *f = fopen(resultFile, "a");
+        if (!f)
+            throw cRuntimeError("Cannot open benchmark result file '%s'", resultFile);
+        if (!exists)
+            fprintf(f, "benchmark,packets,served,wallTime,nsPerPacket,events,eventsPerSecond,peakRssKiB\n");
+        fprintf(f, "%s,%ld,%ld,%.6f,%.1f,%lld,%.0f,%ld\n", benchmark, numGenerated, numServed, wallTime,
+                nsPerPacket, (long long)numEvents, eventsPerSecond, peakRss);
+        fclose(f);
+    }
+    EV_INFO << "benchmark " << benchmark << ": " << nsPerPacket << " ns/packet, " << eventsPerSecond
+            << " events/s, peak RSS " << peakRss << " KiB\n";
+}
+
+} // namespace inet
+
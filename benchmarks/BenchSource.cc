@@ -0,0 +1,45 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "inet/common/queue/benchmarks/BenchSource.h"
+
+namespace inet {
+
+Define_Module(BenchSource);
+
+BenchSource::~BenchSource()
+{
+    cancelAndDelete(timer);
+}
+
+void BenchSource::initialize()
+{
+    outGate = gate("out");
+    timer = new cMessage("send");
+    scheduleAt(simTime() + par("startTime").doubleValue(), timer);
+}
+
+void BenchSource::handleMessage(cMessage *msg)
+{
+    ASSERT(msg == timer);
+    cPacket *packet = new cPacket("bench");
+    packet->setByteLength(par("packetLength").intValue());
+    send(packet, outGate);
+    numGenerated++;
+    scheduleAt(simTime() + par("sendInterval").doubleValue(), timer);
+}
+
+} // namespace inet
+
@@ -0,0 +1,47 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef __INET_BENCHSOURCE_H
+#define __INET_BENCHSOURCE_H
+
+#include "inet/common/INETDefs.h"
+
+namespace inet {
+
+/**
+ * Synthetic packet source of the queue benchmarks. See NED for more info.
+ */
+class INET_API BenchSource : public cSimpleModule
+{
+  protected:
+    cMessage *timer = nullptr;
+    cGate *outGate = nullptr;
+    long numGenerated = 0;
+
+  public:
+    BenchSource() {}
+    virtual ~BenchSource();
+
+    long getNumGenerated() const { return numGenerated; }
+
+  protected:
+    virtual void initialize() override;
+    virtual void handleMessage(cMessage *msg) override;
+};
+
+} // namespace inet
+
+#endif // ifndef __INET_BENCHSOURCE_H
+
@@ -0,0 +1,397 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+//
+// aqmbound: network calculus worst-case delay and backlog bounds for the
+// queues behind a GatedScheduler, without simulating.
+//
+//   aqmbound --gate-period 10ms,20ms --gate-rate 0.1,0.2 --frame-capacity 100
+//            -c 20Mbps,3000B,1500B -c 10Mbps,1500B,200B --deadline 15ms
+//
+// Every -c option adds a traffic class, in the priority order of the
+// scheduler inputs, with a token bucket arrival curve (rate, burst) and its
+// largest and, optionally, smallest frame size. The gate, queue and link
+// options take comma separated lists like aqmreplay; one CSV row is written
+// per class and element of their cartesian product.
+//
+// The gated link is a rate-latency server: in every period the gate is
+// open for gate_rate * gate_period, minus the guard band of the largest
+// frame, which GatedScheduler does not start when it would not end before
+// the gate closes. So R = C * (open - Lmax/C) / period and the latency is
+// period - (open - Lmax/C). Class k sees the strict priority leftover
+// R_k = R - sum(r_j), T_k = (R * T + sum(b_j) + Lmax_lower) / R_k over the
+// higher classes j, with one lower priority frame of blocking. For a token
+// bucket (r, b) with r <= R_k the bounds are
+//
+//   delay <= T_k + b / R_k,   backlog <= b + r * T_k.
+//
+// A class with r > R_k is unstable; with a finite frameCapacity or
+// byteCapacity it loses packets and its delay is bounded by draining the
+// full queue instead. Frame sizes and rates are counted on the wire,
+// including --overhead bytes per frame (preamble, SFD and inter-frame gap,
+// as SerializationModel does). The codelSilent column tells whether the
+// delay bound is below the CoDel target, i.e. CoDel never drops.
+//
+// With --check FILE.vec the bounds are compared with the maxima of the
+// virtualSojournDelay, queueingTime and queueLength vectors that a run
+// recorded for the queue of each class (module path ending in
+// --queue-module, %d being the class index). Violations are reported on
+// stderr and make the exit status 3. A run has a single gate and queue
+// configuration, so --check takes one value of each grid option.
+//
+// Build: g++ -O2 -std=c++11 tools/aqmbound.cc -o aqmbound
+//
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace {
+
+const double INF = std::numeric_limits<double>::infinity();
+
+[[noreturn]] void fail(const char *fmt, const char *arg = "")
+{
+    fprintf(stderr, "aqmbound: ");
+    fprintf(stderr, fmt, arg);
+    fprintf(stderr, "\n");
+    exit(1);
+}
+
+/**
+ * Parses a number with an optional unit: s/ms/us/ns for times, bps with an
+ * optional k/M/G prefix for rates, B for bytes. Plain numbers are taken as
+ * seconds, bit/s and bytes.
+ */
+double parseQuantity(const char *s)
+{
+    char *end;
+    double value = strtod(s, &end);
+    if (end == s)
+        fail("invalid value '%s'", s);
+    std::string unit = end;
+    static const std::map<std::string, double> units = {
+        { "", 1 }, { "s", 1 }, { "ms", 1e-3 }, { "us", 1e-6 }, { "ns", 1e-9 },
+        { "bps", 1 }, { "kbps", 1e3 }, { "Kbps", 1e3 }, { "Mbps", 1e6 }, { "Gbps", 1e9 },
+        { "B", 1 }, { "KiB", 1024 }, { "MiB", 1024 * 1024 },
+    };
+    auto it = units.find(unit);
+    if (it == units.end())
+        fail("unknown unit in '%s'", s);
+    return value * it->second;
+}
+
+std::vector<std::string> split(const char *s, char separator = ',')
+{
+    std::vector<std::string> result;
+    const char *start = s;
+    for (const char *p = s; ; p++) {
+        if (*p == separator || *p == '\0') {
+            if (p > start)
+                result.push_back(std::string(start, p));
+            start = p + 1;
+            if (*p == '\0')
+                break;
+        }
+    }
+    return result;
+}
+
+std::vector<double> parseList(const char *s)
+{
+    std::vector<double> result;
+    for (auto& token : split(s))
+        result.push_back(parseQuantity(token.c_str()));
+    return result;
+}
+
+std::string formatValue(double value)
+{
+    if (std::isinf(value))
+        return "inf";
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.9g", value);
+    return buf;
+}
+
+struct TrafficClass
+{
+    double rate;        // bit/s of payload
+    double burst;       // bytes
+    double maxFrame;    // bytes
+    double minFrame;    // bytes
+};
+
+struct Point
+{
+    double gatePeriod;
+    double gateRate;
+    double frameCapacity;
+    double byteCapacity;
+};
+
+struct Bound
+{
+    double serviceRate = 0;     // bit/s left for the class
+    double latency = INF;       // s
+    double delay = INF;         // s
+    double backlog = INF;       // bytes on the wire
+    double backlogPackets = INF;
+    bool stable = false;
+};
+
+/**
+ * Bounds for every class at one parameter point; see the file comment.
+ */
+std::vector<Bound> computeBounds(const std::vector<TrafficClass>& classes, const Point& p, double datarate, double overhead)
+{
+    std::vector<Bound> bounds(classes.size());
+    // wire view: every frame carries the overhead, worst case for the smallest frames
+    auto wireFactor = [overhead](const TrafficClass& c) { return (c.minFrame + overhead) / c.minFrame; };
+    double maxFrameBits = 0;
+    for (auto& c : classes)
+        maxFrameBits = std::max(maxFrameBits, (c.maxFrame + overhead) * 8);
+
+    double open = p.gateRate * p.gatePeriod - maxFrameBits / datarate;
+    if (open <= 0)
+        return bounds;  // the window is shorter than the guard band: no service
+    double rate = datarate * open / p.gatePeriod;
+    double latency = p.gatePeriod - open;
+
+    double higherRate = 0, higherBurst = 0;
+    for (size_t k = 0; k < classes.size(); k++) {
+        const TrafficClass& c = classes[k];
+        double r = c.rate * wireFactor(c);
+        double b = c.burst * 8 * wireFactor(c);
+        double lowerFrameBits = 0;
+        for (size_t j = k + 1; j < classes.size(); j++)
+            lowerFrameBits = std::max(lowerFrameBits, (classes[j].maxFrame + overhead) * 8);
+
+        Bound& bound = bounds[k];
+        bound.serviceRate = rate - higherRate;
+        if (bound.serviceRate > 0) {
+            bound.latency = (rate * latency + higherBurst + lowerFrameBits) / bound.serviceRate;
+            bound.stable = r <= bound.serviceRate;
+            double capacityBits = INF;
+            if (p.byteCapacity > 0)
+                capacityBits = p.byteCapacity * 8 * wireFactor(c);
+            else if (p.frameCapacity > 0)
+                capacityBits = p.frameCapacity * (c.maxFrame + overhead) * 8;
+            double backlogBits = bound.stable ? std::min(b + r * bound.latency, capacityBits) : capacityBits;
+            bound.backlog = backlogBits / 8;
+            bound.delay = bound.latency + backlogBits / bound.serviceRate;
+            if (bound.stable)
+                bound.delay = std::min(bound.delay, bound.latency + b / bound.serviceRate);
+            bound.backlogPackets = std::ceil(bound.backlog / (c.minFrame + overhead));
+            if (p.frameCapacity > 0)
+                bound.backlogPackets = std::min(bound.backlogPackets, p.frameCapacity);
+        }
+        higherRate += r;
+        higherBurst += b;
+    }
+    return bounds;
+}
+
+/**
+ * Maxima of the sojourn and queue length vectors of one module, read from
+ * an OMNeT++ vector file.
+ */
+struct Observed
+{
+    double maxSojourn = -1;
+    double maxLength = -1;
+};
+
+std::map<std::string, Observed> readVectors(const char *fileName)
+{
+    FILE *f = fopen(fileName, "r");
+    if (!f)
+        fail("cannot open '%s'", fileName);
+    std::map<long, std::pair<std::string, bool>> vectors;  // id -> module, is sojourn
+    std::map<std::string, Observed> observed;
+    char line[4096];
+    while (fgets(line, sizeof(line), f)) {
+        if (strncmp(line, "vector ", 7) == 0) {
+            char module[2048], name[1024];
+            long id;
+            if (sscanf(line + 7, "%ld %2047s %1023s", &id, module, name) != 3)
+                continue;
+            std::string n = name;
+            if (n.front() == '"')
+                n = n.substr(1, n.size() - 2);
+            bool sojourn = n == "virtualSojournDelay:vector" || n == "queueingTime:vector";
+            if (sojourn || n == "queueLength:vector")
+                vectors[id] = std::make_pair(std::string(module), sojourn);
+            continue;
+        }
+        if (!isdigit((unsigned char)line[0]))
+            continue;
+        char *p = line;
+        long id = strtol(p, &p, 10);
+        auto it = vectors.find(id);
+        if (it == vectors.end())
+            continue;
+        // the value is the last column, whatever the ETV layout
+        char *last = strrchr(line, '\t');
+        double value = atof(last ? last + 1 : p);
+        Observed& o = observed[it->second.first];
+        if (it->second.second)
+            o.maxSojourn = std::max(o.maxSojourn, value);
+        else
+            o.maxLength = std::max(o.maxLength, value);
+    }
+    fclose(f);
+    return observed;
+}
+
+/** The queue module suffix of class k: pattern with %d replaced by k. */
+std::string moduleSuffix(const std::string& pattern, size_t k)
+{
+    std::string suffix = pattern;
+    size_t pos = suffix.find("%d");
+    if (pos != std::string::npos)
+        suffix.replace(pos, 2, std::to_string(k));
+    return suffix;
+}
+
+bool endsWith(const std::string& s, const std::string& suffix)
+{
+    return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+void usage()
+{
+    fprintf(stderr,
+            "usage: aqmbound [options] -c RATE,BURST,MAXFRAME[,MINFRAME] ...\n"
+            "  -c RATE,BURST,MAXFRAME[,MINFRAME]\n"
+            "                             traffic class with a token bucket arrival curve, in\n"
+            "                             scheduler input order (MINFRAME defaults to 64B)\n"
+            "  --gate-period LIST         gate period (default 10ms)\n"
+            "  --gate-rate LIST           open fraction of the gate period (default 0.1)\n"
+            "  --frame-capacity LIST      queue limit in packets, 0 = unlimited (default 0)\n"
+            "  --byte-capacity LIST       queue limit in bytes, 0 = unlimited (default 0)\n"
+            "  --datarate RATE            link datarate (default 100Mbps)\n"
+            "  --overhead BYTES           per-frame wire overhead (default 20)\n"
+            "  --target TIME              CoDel target for the codelSilent column (default 5ms)\n"
+            "  --deadline TIME            fill the meetsDeadline column\n"
+            "  --check FILE.vec           compare the bounds with a recorded run\n"
+            "  --queue-module PATTERN     module path suffix of class %%d's queue (default queue[%%d],\n"
+            "                             just queue with a single class)\n");
+    exit(2);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    std::vector<TrafficClass> classes;
+    std::vector<double> gatePeriods = { 10e-3 }, gateRates = { 0.1 }, frameCapacities = { 0 }, byteCapacities = { 0 };
+    double datarate = 100e6, overhead = 20, target = 5e-3, deadline = -1;
+    const char *checkFile = nullptr;
+    std::string queueModule;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto next = [&]() -> const char * { if (i + 1 >= argc) usage(); return argv[++i]; };
+        if (arg == "-c") {
+            std::vector<double> v = parseList(next());
+            if (v.size() < 3 || v.size() > 4)
+                usage();
+            TrafficClass c = { v[0], v[1], v[2], v.size() > 3 ? v[3] : 64 };
+            if (c.rate < 0 || c.burst < 0 || c.minFrame <= 0 || c.maxFrame < c.minFrame)
+                fail("invalid traffic class '%s'", argv[i]);
+            classes.push_back(c);
+        }
+        else if (arg == "--gate-period") gatePeriods = parseList(next());
+        else if (arg == "--gate-rate") gateRates = parseList(next());
+        else if (arg == "--frame-capacity") frameCapacities = parseList(next());
+        else if (arg == "--byte-capacity") byteCapacities = parseList(next());
+        else if (arg == "--datarate") datarate = parseQuantity(next());
+        else if (arg == "--overhead") overhead = parseQuantity(next());
+        else if (arg == "--target") target = parseQuantity(next());
+        else if (arg == "--deadline") deadline = parseQuantity(next());
+        else if (arg == "--check") checkFile = next();
+        else if (arg == "--queue-module") queueModule = next();
+        else usage();
+    }
+    if (classes.empty() || datarate <= 0)
+        usage();
+    if (queueModule.empty())
+        queueModule = classes.size() == 1 ? "queue" : "queue[%d]";
+
+    std::map<std::string, Observed> observed;
+    if (checkFile) {
+        if (gatePeriods.size() * gateRates.size() * frameCapacities.size() * byteCapacities.size() != 1)
+            fail("--check needs a single value of --gate-period, --gate-rate, --frame-capacity and --byte-capacity, those of the run in '%s'", checkFile);
+        observed = readVectors(checkFile);
+    }
+
+    printf("gate_period,gate_rate,frameCapacity,byteCapacity,class,serviceRate,latency,delayBound,backlogBytes,backlogPackets,stable,codelSilent,meetsDeadline\n");
+    int violations = 0;
+    for (double gatePeriod : gatePeriods) {
+        for (double gateRate : gateRates) {
+            for (double frameCapacity : frameCapacities) {
+                for (double byteCapacity : byteCapacities) {
+                    Point p = { gatePeriod, gateRate, frameCapacity, byteCapacity };
+                    std::vector<Bound> bounds = computeBounds(classes, p, datarate, overhead);
+                    for (size_t k = 0; k < bounds.size(); k++) {
+                        const Bound& b = bounds[k];
+                        printf("%s,%g,%g,%g,%zu,%s,%s,%s,%s,%s,%d,%d,%s\n", formatValue(gatePeriod).c_str(), gateRate,
+                                frameCapacity, byteCapacity, k, formatValue(b.serviceRate).c_str(), formatValue(b.latency).c_str(),
+                                formatValue(b.delay).c_str(), formatValue(b.backlog).c_str(), formatValue(b.backlogPackets).c_str(),
+                                b.stable ? 1 : 0, b.delay < target ? 1 : 0, deadline < 0 ? "" : b.delay <= deadline ? "1" : "0");
+                        if (!checkFile)
+                            continue;
+                        std::string suffix = moduleSuffix(queueModule, k);
+                        for (auto& entry : observed) {
+                            if (!endsWith(entry.first, suffix))
+                                continue;
+                            const Observed& o = entry.second;
+                            if (o.maxSojourn > b.delay) {
+                                fprintf(stderr, "aqmbound: %s: sojourn %gs exceeds the delay bound %gs\n",
+                                        entry.first.c_str(), o.maxSojourn, b.delay);
+                                violations++;
+                            }
+                            if (o.maxLength > b.backlogPackets) {
+                                fprintf(stderr, "aqmbound: %s: queue length %g exceeds the backlog bound %g\n",
+                                        entry.first.c_str(), o.maxLength, b.backlogPackets);
+                                violations++;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+    if (checkFile) {
+        size_t matched = 0;
+        for (size_t k = 0; k < classes.size(); k++) {
+            std::string suffix = moduleSuffix(queueModule, k);
+            for (auto& entry : observed)
+                if (endsWith(entry.first, suffix))
+                    matched++;
+        }
+        if (matched == 0)
+            fprintf(stderr, "aqmbound: no sojourn or queue length vectors of the class queues in '%s'\n", checkFile);
+        else
+            fprintf(stderr, "aqmbound: checked %zu queue(s), %d violation(s)\n", matched, violations);
+    }
+    return violations > 0 ? 3 : 0;
+}
@@ -0,0 +1,604 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+//
+// aqmreplay: replays an arrival/departure trace through the CoDel and RED
+// decision code used by CodelActiveQueue and REDDropper, without OMNeT++.
+//
+// Trace format, one event per line ('#' starts a comment):
+//
+//   a <time> <bytes> <flow>    packet arrival at the queue
+//   d <time>                   the scheduler requests a packet
+//
+// Times are decimal seconds, optionally with an s/ms/us/ns suffix, and are
+// converted to simulation time ticks exactly (default scale 1e-12, like
+// OMNeT++). Events must be sorted by time. A request that finds the queue
+// empty is remembered and served by the next arrival, as PassiveQueueBase
+// does.
+//
+// Every list-valued option is swept: one CSV row is written per element of
+// the cartesian product of the lists.
+//
+// Build: g++ -O2 -std=c++11 -pthread -I<inet>/src tools/aqmreplay.cc -o aqmreplay
+//
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "inet/common/queue/CodelCore.h"
+#include "inet/common/queue/REDCore.h"
+
+using namespace inet;
+
+typedef CodelCore::ticks_t ticks_t;
+
+namespace {
+
+int scaleExp = -12;
+
+[[noreturn]] void fail(const char *fmt, const char *arg = "")
+{
+    fprintf(stderr, "aqmreplay: ");
+    fprintf(stderr, fmt, arg);
+    fprintf(stderr, "\n");
+    exit(1);
+}
+
+/**
+ * Parses "12.5ms" style times into ticks without going through double,
+ * so the result is the same tick value SimTime::parse() gives.
+ */
+ticks_t parseTime(const char *s, const char **end = nullptr)
+{
+    const char *p = s;
+    while (*p == ' ' || *p == '\t')
+        p++;
+    bool negative = *p == '-';
+    if (*p == '-' || *p == '+')
+        p++;
+    // digits as a decimal mantissa with exponent
+    int64_t mantissa = 0;
+    int exp = 0;
+    bool any = false;
+    for (; *p >= '0' && *p <= '9'; p++, any = true)
+        mantissa = mantissa * 10 + (*p - '0');
+    if (*p == '.') {
+        for (p++; *p >= '0' && *p <= '9'; p++, any = true) {
+            if (mantissa < INT64_MAX / 100) {
+                mantissa = mantissa * 10 + (*p - '0');
+                exp--;
+            }
+        }
+    }
+    if (!any)
+        fail("invalid time value '%s'", s);
+    if (p[0] == 's' && !isalpha(p[1]))
+        p++;
+    else if (p[0] == 'm' && p[1] == 's')
+        exp -= 3, p += 2;
+    else if (p[0] == 'u' && p[1] == 's')
+        exp -= 6, p += 2;
+    else if (p[0] == 'n' && p[1] == 's')
+        exp -= 9, p += 2;
+    else if (p[0] == 'p' && p[1] == 's')
+        exp -= 12, p += 2;
+    exp -= scaleExp;
+    for (; exp > 0; exp--)
+        mantissa *= 10;
+    for (; exp < 0; exp++)
+        mantissa /= 10;
+    if (end)
+        *end = p;
+    return negative ? -mantissa : mantissa;
+}
+
+std::string formatTime(ticks_t t)
+{
+    int64_t scale = 1;
+    for (int i = 0; i < -scaleExp; i++)
+        scale *= 10;
+    std::string sign = t < 0 ? "-" : "";
+    if (t < 0)
+        t = -t;
+    std::string fraction = std::to_string(t % scale);
+    fraction.insert(0, -scaleExp - fraction.size(), '0');
+    return sign + std::to_string(t / scale) + "." + fraction;
+}
+
+std::vector<std::string> split(const char *s)
+{
+    std::vector<std::string> result;
+    const char *start = s;
+    for (const char *p = s; ; p++) {
+        if (*p == ',' || *p == '\0') {
+            if (p > start)
+                result.push_back(std::string(start, p));
+            start = p + 1;
+            if (*p == '\0')
+                break;
+        }
+    }
+    return result;
+}
+
+std::vector<ticks_t> parseTimeList(const char *s)
+{
+    std::vector<ticks_t> result;
+    for (auto& token : split(s))
+        result.push_back(parseTime(token.c_str()));
+    return result;
+}
+
+std::vector<double> parseDoubleList(const char *s)
+{
+    std::vector<double> result;
+    for (auto& token : split(s))
+        result.push_back(atof(token.c_str()));
+    return result;
+}
+
+std::vector<long> parseLongList(const char *s)
+{
+    std::vector<long> result;
+    for (auto& token : split(s))
+        result.push_back(atol(token.c_str()));
+    return result;
+}
+
+/**
+ * The trace, stored column-wise so replaying it only streams memory.
+ */
+struct Trace
+{
+    std::vector<ticks_t> times;
+    std::vector<int32_t> sizes;    // -1 for departure requests
+    std::vector<int32_t> flows;
+    long arrivals = 0;
+
+    void load(const char *fileName)
+    {
+        FILE *f = strcmp(fileName, "-") == 0 ? stdin : fopen(fileName, "rb");
+        if (!f)
+            fail("cannot open trace file '%s'", fileName);
+        std::string data;
+        char buf[1 << 16];
+        size_t n;
+        while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+            data.append(buf, n);
+        if (f != stdin)
+            fclose(f);
+
+        const char *p = data.c_str();
+        ticks_t lastTime = INT64_MIN;
+        while (*p) {
+            while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')
+                p++;
+            if (!*p)
+                break;
+            if (*p == '#') {
+                while (*p && *p != '\n')
+                    p++;
+                continue;
+            }
+            char kind = *p++;
+            if (kind != 'a' && kind != 'd')
+                fail("invalid event type in trace near '%.20s'", p - 1);
+            ticks_t t = parseTime(p, &p);
+            if (t < lastTime)
+                fail("trace is not sorted by time near '%.20s'", p);
+            lastTime = t;
+            times.push_back(t);
+            if (kind == 'a') {
+                char *end;
+                sizes.push_back((int32_t)strtol(p, &end, 10));
+                flows.push_back((int32_t)strtol(end, &end, 10));
+                p = end;
+                arrivals++;
+            }
+            else {
+                sizes.push_back(-1);
+                flows.push_back(-1);
+            }
+            while (*p && *p != '\n')
+                p++;
+        }
+    }
+
+    size_t size() const { return times.size(); }
+};
+
+/**
+ * FIFO of trace event indices, doubling its power-of-two storage when full.
+ */
+class ReplayQueue
+{
+  protected:
+    std::vector<uint32_t> slots;
+    size_t mask = 0;
+    size_t head = 0;
+    size_t length = 0;
+
+  public:
+    ReplayQueue() { slots.resize(1024); mask = slots.size() - 1; }
+
+    bool empty() const { return length == 0; }
+    size_t size() const { return length; }
+
+    void push(uint32_t index)
+    {
+        if (length == slots.size()) {
+            std::vector<uint32_t> grown(slots.size() * 2);
+            for (size_t i = 0; i < length; i++)
+                grown[i] = slots[(head + i) & mask];
+            slots.swap(grown);
+            mask = slots.size() - 1;
+            head = 0;
+        }
+        slots[(head + length) & mask] = index;
+        length++;
+    }
+
+    uint32_t pop()
+    {
+        uint32_t index = slots[head];
+        head = (head + 1) & mask;
+        length--;
+        return index;
+    }
+};
+
+struct Options
+{
+    std::string aqm = "codel";
+    std::string decisionsFile;
+    int threads = 1;
+    uint32_t seed = 0;
+    // CoDel
+    std::vector<ticks_t> targets, intervals, gatePeriods;
+    std::vector<double> gateRates;
+    std::vector<long> mtus, frameCapacities;
+    bool adapt = false;
+    bool fast = false;
+    // RED
+    std::vector<double> wqs, minths, maxths, maxps, pkrates;
+};
+
+struct Point
+{
+    ticks_t target = 0, interval = 0, gatePeriod = 0;
+    double gateRate = 0;
+    long mtu = 0, frameCapacity = 0;
+    double wq = 0, minth = 0, maxth = 0, maxp = 0, pkrate = 0;
+};
+
+struct Result
+{
+    long delivered = 0;
+    long tailDrops = 0;
+    long aqmDrops = 0;
+    double seconds = 0;
+};
+
+struct DecisionLog
+{
+    FILE *f = nullptr;
+    size_t point = 0;
+
+    void drop(const Trace& trace, uint32_t index, ticks_t now, const char *reason)
+    {
+        if (f)
+            fprintf(f, "%zu\t%s\t%s\t%d\t%d\t%s\n", point, formatTime(now).c_str(), formatTime(trace.times[index]).c_str(),
+                    trace.flows[index], trace.sizes[index], reason);
+    }
+};
+
+class ReplayCodelView
+{
+  public:
+    typedef uint32_t Item;
+
+  protected:
+    const Trace& trace;
+    ReplayQueue& queue;
+    Result& result;
+    DecisionLog& log;
+
+  public:
+    ticks_t now = 0;
+    long bytes = 0;     // byte backlog, as CodelActiveQueue keeps it
+
+    ReplayCodelView(const Trace& trace, ReplayQueue& queue, Result& result, DecisionLog& log) :
+        trace(trace), queue(queue), result(result), log(log) {}
+
+    void push(uint32_t index) { queue.push(index); bytes += trace.sizes[index]; }
+    uint32_t pop() { uint32_t index = queue.pop(); bytes -= trace.sizes[index]; return index; }
+    ticks_t enqueueTime(uint32_t index) const { return trace.times[index]; }
+    long backlog() const { return bytes; }
+    bool mark(uint32_t&) { return false; } // traces carry no ECN codepoints
+    void drop(uint32_t index) { result.aqmDrops++; log.drop(trace, index, now, "codel"); }
+};
+
+Result replayCodel(const Trace& trace, const Point& point, bool fast, DecisionLog& log)
+{
+    Result result;
+    CodelCore::Parameters params;
+    params.target = point.target;
+    params.interval = point.interval;
+    params.mtu = point.mtu;
+    params.adapt = point.gatePeriod > 0;
+    params.gatePeriod = point.gatePeriod;
+    params.blockingTime = CodelCore::scale(point.gatePeriod, point.gateRate);
+    params.fast = fast;
+    CodelCore codel;
+    codel.setParameters(params);
+
+    ReplayQueue queue;
+    ReplayCodelView view(trace, queue, result, log);
+    long pendingRequests = 0;
+    const size_t n = trace.size();
+    for (size_t i = 0; i < n; i++) {
+        ticks_t now = trace.times[i];
+        if (trace.sizes[i] >= 0) {
+            if (pendingRequests > 0) {
+                pendingRequests--;
+                result.delivered++;
+            }
+            else if (point.frameCapacity && (long)queue.size() >= point.frameCapacity) {
+                result.tailDrops++;
+                log.drop(trace, (uint32_t)i, now, "tail");
+            }
+            else
+                view.push((uint32_t)i);
+        }
+        else if (queue.empty())
+            pendingRequests++;
+        else {
+            view.now = now;
+            codel.dequeue(now, view);
+            result.delivered++;
+        }
+    }
+    return result;
+}
+
+Result replayRED(const Trace& trace, const Point& point, uint32_t seed, bool fast, DecisionLog& log)
+{
+    Result result;
+    REDCore red;
+    red.setWeight(point.wq, fast);
+    REDCore::Gate gate;
+    gate.minth = point.minth;
+    gate.maxth = point.maxth;
+    gate.maxp = point.maxp;
+    gate.pkrate = point.pkrate;
+    ticks_t qTime = 0;
+    // same generator and [0,1) mapping as cMersenneTwister::doubleRand()
+    std::mt19937 mt(seed);
+    auto rng = [&mt]() { return mt() * (1.0 / 4294967296.0); };
+    const double secondsPerTick = std::pow(10.0, scaleExp);
+
+    ReplayQueue queue;
+    long pendingRequests = 0;
+    const size_t n = trace.size();
+    for (size_t i = 0; i < n; i++) {
+        ticks_t now = trace.times[i];
+        if (trace.sizes[i] >= 0) {
+            int queueLength = (int)queue.size();
+            double idleTime = queueLength > 0 ? 0.0 : (now - qTime) * secondsPerTick;
+            REDCore::Verdict verdict = red.decide(queueLength, idleTime, gate, rng);
+            if (verdict != REDCore::NO_DROP) {
+                result.aqmDrops++;
+                log.drop(trace, (uint32_t)i, now, verdict == REDCore::RANDOM_EARLY_DROP ? "red-early" : "red-forced");
+                continue;
+            }
+            if (queueLength == 0)
+                qTime = now;
+            if (pendingRequests > 0) {
+                pendingRequests--;
+                result.delivered++;
+            }
+            else if (point.frameCapacity && (long)queue.size() >= point.frameCapacity) {
+                result.tailDrops++;
+                log.drop(trace, (uint32_t)i, now, "tail");
+            }
+            else
+                queue.push((uint32_t)i);
+        }
+        else if (queue.empty())
+            pendingRequests++;
+        else {
+            queue.pop();
+            result.delivered++;
+        }
+    }
+    return result;
+}
+
+std::vector<Point> expand(const Options& opt)
+{
+    std::vector<Point> points;
+    for (long frameCapacity : opt.frameCapacities) {
+        if (opt.aqm == "codel") {
+            for (ticks_t target : opt.targets)
+                for (ticks_t interval : opt.intervals)
+                    for (long mtu : opt.mtus)
+                        for (ticks_t gatePeriod : opt.gatePeriods)
+                            for (double gateRate : opt.gateRates) {
+                                Point p;
+                                p.frameCapacity = frameCapacity;
+                                p.target = target;
+                                p.interval = interval;
+                                p.mtu = mtu;
+                                p.gatePeriod = opt.adapt ? gatePeriod : 0;
+                                p.gateRate = gateRate;
+                                points.push_back(p);
+                            }
+        }
+        else {
+            for (double wq : opt.wqs)
+                for (double minth : opt.minths)
+                    for (double maxth : opt.maxths)
+                        for (double maxp : opt.maxps)
+                            for (double pkrate : opt.pkrates) {
+                                Point p;
+                                p.frameCapacity = frameCapacity;
+                                p.wq = wq;
+                                p.minth = minth;
+                                p.maxth = maxth;
+                                p.maxp = maxp;
+                                p.pkrate = pkrate;
+                                points.push_back(p);
+                            }
+        }
+    }
+    return points;
+}
+
+void usage()
+{
+    fprintf(stderr,
+            "usage: aqmreplay [options] <trace-file|->\n"
+            "  --aqm codel|red            decision code to replay (default codel)\n"
+            "  --frame-capacity LIST      tail drop limit in packets, 0 = unlimited (default 0)\n"
+            "  --target LIST              CoDel target (default 5ms)\n"
+            "  --interval LIST            CoDel interval (default 100ms)\n"
+            "  --mtu LIST                 CoDel minimum byte backlog for dropping (default 1500)\n"
+            "  --adapt                    use the gated virtual sojourn time\n"
+            "  --fast                     fastMode: integer-only CoDel arithmetic, table-driven RED\n"
+            "  --gate-period LIST         gate period for --adapt (default 10ms)\n"
+            "  --gate-rate LIST           open fraction of the gate period (default 0.1)\n"
+            "  --wq LIST --minth LIST --maxth LIST --maxp LIST --pkrate LIST\n"
+            "                             RED parameters (defaults 0.002, 5, 50, 0.02, 150)\n"
+            "  --seed N                   seed of the Mersenne Twister used by RED (default 0)\n"
+            "  --scale-exp N              simulation time scale exponent (default -12)\n"
+            "  --threads N                replay parameter points in parallel (default 1)\n"
+            "  --decisions FILE           write every drop (forces --threads 1)\n");
+    exit(2);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    Options opt;
+    const char *traceFile = nullptr;
+    const char *targets = "5ms", *intervals = "100ms", *gatePeriods = "10ms";
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto next = [&]() -> const char * { if (i + 1 >= argc) usage(); return argv[++i]; };
+        if (arg == "--aqm") opt.aqm = next();
+        else if (arg == "--frame-capacity") opt.frameCapacities = parseLongList(next());
+        else if (arg == "--target") targets = next();
+        else if (arg == "--interval") intervals = next();
+        else if (arg == "--mtu") opt.mtus = parseLongList(next());
+        else if (arg == "--adapt") opt.adapt = true;
+        else if (arg == "--fast") opt.fast = true;
+        else if (arg == "--gate-period") gatePeriods = next();
+        else if (arg == "--gate-rate") opt.gateRates = parseDoubleList(next());
+        else if (arg == "--wq") opt.wqs = parseDoubleList(next());
+        else if (arg == "--minth") opt.minths = parseDoubleList(next());
+        else if (arg == "--maxth") opt.maxths = parseDoubleList(next());
+        else if (arg == "--maxp") opt.maxps = parseDoubleList(next());
+        else if (arg == "--pkrate") opt.pkrates = parseDoubleList(next());
+        else if (arg == "--seed") opt.seed = (uint32_t)strtoul(next(), nullptr, 10);
+        else if (arg == "--scale-exp") scaleExp = atoi(next());
+        else if (arg == "--threads") opt.threads = std::max(1, atoi(next()));
+        else if (arg == "--decisions") opt.decisionsFile = next();
+        else if (arg[0] == '-' && arg != "-") usage();
+        else traceFile = argv[i];
+    }
+    if (!traceFile || (opt.aqm != "codel" && opt.aqm != "red"))
+        usage();
+    // times are parsed after --scale-exp is known
+    opt.targets = parseTimeList(targets);
+    opt.intervals = parseTimeList(intervals);
+    opt.gatePeriods = parseTimeList(gatePeriods);
+    if (opt.frameCapacities.empty()) opt.frameCapacities = { 0 };
+    if (opt.mtus.empty()) opt.mtus = { 1500 };
+    if (opt.gateRates.empty()) opt.gateRates = { 0.1 };
+    if (opt.wqs.empty()) opt.wqs = { 0.002 };
+    if (opt.minths.empty()) opt.minths = { 5 };
+    if (opt.maxths.empty()) opt.maxths = { 50 };
+    if (opt.maxps.empty()) opt.maxps = { 0.02 };
+    if (opt.pkrates.empty()) opt.pkrates = { 150 };
+
+    Trace trace;
+    trace.load(traceFile);
+    if (trace.size() > UINT32_MAX)
+        fail("trace too long");
+
+    std::vector<Point> points = expand(opt);
+    std::vector<Result> results(points.size());
+
+    DecisionLog mainLog;
+    if (!opt.decisionsFile.empty()) {
+        mainLog.f = fopen(opt.decisionsFile.c_str(), "w");
+        if (!mainLog.f)
+            fail("cannot open '%s'", opt.decisionsFile.c_str());
+        fprintf(mainLog.f, "point\ttime\tenqueueTime\tflow\tbytes\treason\n");
+        opt.threads = 1;
+    }
+
+    std::atomic<size_t> nextPoint(0);
+    auto worker = [&]() {
+        DecisionLog log = mainLog;
+        for (size_t k; (k = nextPoint++) < points.size(); ) {
+            log.point = k;
+            auto start = std::chrono::steady_clock::now();
+            results[k] = opt.aqm == "codel" ? replayCodel(trace, points[k], opt.fast, log) : replayRED(trace, points[k], opt.seed, opt.fast, log);
+            results[k].seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+    };
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int i = 1; i < opt.threads; i++)
+        threads.emplace_back(worker);
+    worker();
+    for (auto& thread : threads)
+        thread.join();
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (mainLog.f)
+        fclose(mainLog.f);
+
+    if (opt.aqm == "codel")
+        printf("frameCapacity,target,interval,MTU,gate_period,gate_rate,arrivals,delivered,tailDrops,aqmDrops,Mpps\n");
+    else
+        printf("frameCapacity,wq,minth,maxth,maxp,pkrate,arrivals,delivered,tailDrops,aqmDrops,Mpps\n");
+    for (size_t k = 0; k < points.size(); k++) {
+        const Point& p = points[k];
+        const Result& r = results[k];
+        double mpps = r.seconds > 0 ? trace.arrivals / r.seconds / 1e6 : 0;
+        if (opt.aqm == "codel")
+            printf("%ld,%s,%s,%ld,%s,%g,%ld,%ld,%ld,%ld,%.2f\n", p.frameCapacity, formatTime(p.target).c_str(),
+                    formatTime(p.interval).c_str(), p.mtu, formatTime(p.gatePeriod).c_str(), p.gateRate,
+                    trace.arrivals, r.delivered, r.tailDrops, r.aqmDrops, mpps);
+        else
+            printf("%ld,%g,%g,%g,%g,%g,%ld,%ld,%ld,%ld,%.2f\n", p.frameCapacity, p.wq, p.minth, p.maxth, p.maxp, p.pkrate,
+                    trace.arrivals, r.delivered, r.tailDrops, r.aqmDrops, mpps);
+    }
+    fprintf(stderr, "aqmreplay: %zu parameter points, %zu events each, %.3fs, %.1f M events/s\n", points.size(),
+            trace.size(), elapsed, elapsed > 0 ? points.size() * (double)trace.size() / elapsed / 1e6 : 0.0);
+    return 0;
+}
+
@@ -0,0 +1,449 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+//
+// aqmsweep: runs a parameter grid of Cmdenv simulations in parallel and
+// merges their scalar results into one table.
+//
+//   aqmsweep -j 8 -o results/gated -p '**.queue.gate_rate=0.05,0.1,0.2'
+//            -p '**.queue.target=2ms,5ms' -- ./inet -u Cmdenv -f omnetpp.ini -c Gated
+//
+// Every -p option adds a grid dimension; one run is made for each element
+// of their cartesian product. The parameters are passed to the simulation
+// as --<key>=<value> command line options, together with the scalar file
+// name. A run's files are named after a hash of its assignments, so they
+// stay valid when the grid is extended or reordered. The scalar file is
+// written under a temporary name and renamed once the run exits with
+// status 0: runs whose .sca file exists are skipped, so an interrupted
+// sweep resumes where it stopped.
+//
+// Runs are distributed round robin over per-worker job queues. A worker
+// takes jobs from the front of its own queue and, when that is empty,
+// steals from the back of the fullest other queue.
+//
+// The summary (-s, default <outdir>/summary.csv) has one row per run: the
+// run name, the swept parameters, then one column per scalar, named
+// <module>.<scalar>, in sorted order.
+//
+// Build: g++ -O2 -std=c++11 -pthread tools/aqmsweep.cc -o aqmsweep
+//
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+[[noreturn]] void fail(const char *fmt, const char *arg = "")
+{
+    fprintf(stderr, "aqmsweep: ");
+    fprintf(stderr, fmt, arg);
+    fprintf(stderr, "\n");
+    exit(1);
+}
+
+struct Dimension
+{
+    std::string key;
+    std::vector<std::string> values;
+};
+
+struct Run
+{
+    std::string name;
+    std::vector<std::string> values;   // one per dimension
+};
+
+struct Options
+{
+    std::vector<Dimension> dimensions;
+    std::vector<std::string> command;
+    std::string outputDir = "results";
+    std::string summaryFile;
+    int jobs = 0;
+    bool vectors = false;
+    bool dryRun = false;
+};
+
+std::vector<std::string> split(const std::string& s, char separator)
+{
+    std::vector<std::string> parts;
+    size_t start = 0;
+    while (true) {
+        size_t end = s.find(separator, start);
+        parts.push_back(s.substr(start, end - start));
+        if (end == std::string::npos)
+            return parts;
+        start = end + 1;
+    }
+}
+
+/** Quotes s for /bin/sh. */
+std::string shellQuote(const std::string& s)
+{
+    std::string quoted = "'";
+    for (char c : s) {
+        if (c == '\'')
+            quoted += "'\\''";
+        else
+            quoted += c;
+    }
+    return quoted + "'";
+}
+
+/** Quotes a CSV field if needed. */
+std::string csvField(const std::string& s)
+{
+    if (s.find_first_of(",\"\n") == std::string::npos)
+        return s;
+    std::string quoted = "\"";
+    for (char c : s) {
+        if (c == '"')
+            quoted += '"';
+        quoted += c;
+    }
+    return quoted + "\"";
+}
+
+/** FNV-1a, used to name runs after their parameter assignments. */
+std::string runName(const std::vector<Dimension>& dimensions, const std::vector<std::string>& values)
+{
+    uint64_t h = 0xcbf29ce484222325ull;
+    auto add = [&h](const std::string& s) {
+        for (unsigned char c : s) {
+            h ^= c;
+            h *= 0x100000001b3ull;
+        }
+        h ^= 0xff;
+        h *= 0x100000001b3ull;
+    };
+    for (size_t i = 0; i < dimensions.size(); i++) {
+        add(dimensions[i].key);
+        add(values[i]);
+    }
+    char buf[32];
+    snprintf(buf, sizeof(buf), "run-%016llx", (unsigned long long)h);
+    return buf;
+}
+
+std::vector<Run> expand(const std::vector<Dimension>& dimensions)
+{
+    std::vector<Run> runs;
+    std::vector<size_t> index(dimensions.size(), 0);
+    while (true) {
+        Run run;
+        for (size_t i = 0; i < dimensions.size(); i++)
+            run.values.push_back(dimensions[i].values[index[i]]);
+        run.name = runName(dimensions, run.values);
+        runs.push_back(run);
+        // odometer increment, last dimension fastest
+        size_t i = dimensions.size();
+        while (i > 0) {
+            i--;
+            if (++index[i] < dimensions[i].values.size())
+                break;
+            index[i] = 0;
+            if (i == 0)
+                return runs;
+        }
+        if (dimensions.empty())
+            return runs;
+    }
+}
+
+bool fileExists(const std::string& path)
+{
+    struct stat st;
+    return stat(path.c_str(), &st) == 0;
+}
+
+/** Runs cmd with /bin/sh and returns its exit status, -1 on abnormal termination. */
+int runCommand(const std::string& cmd)
+{
+    pid_t pid = fork();
+    if (pid < 0)
+        return -1;
+    if (pid == 0) {
+        execl("/bin/sh", "sh", "-c", cmd.c_str(), (char *)nullptr);
+        _exit(127);
+    }
+    int status;
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR)
+            return -1;
+    }
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+/**
+ * Per-worker job queues with work stealing. Jobs are run indices.
+ */
+class JobQueues
+{
+  protected:
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<size_t> jobs;
+    };
+    std::vector<Queue> queues;
+
+  public:
+    JobQueues(int workers, size_t numJobs) : queues(workers)
+    {
+        for (size_t k = 0; k < numJobs; k++)
+            queues[k % workers].jobs.push_back(k);
+    }
+
+    bool take(int worker, size_t& job)
+    {
+        {
+            Queue& own = queues[worker];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.jobs.empty()) {
+                job = own.jobs.front();
+                own.jobs.pop_front();
+                return true;
+            }
+        }
+        // steal from the back of the fullest queue; the victim may have
+        // drained in the meantime, so it is checked again under its lock
+        while (true) {
+            int victim = -1;
+            size_t most = 0;
+            for (int i = 0; i < (int)queues.size(); i++) {
+                if (i == worker)
+                    continue;
+                std::lock_guard<std::mutex> lock(queues[i].mutex);
+                if (queues[i].jobs.size() > most) {
+                    most = queues[i].jobs.size();
+                    victim = i;
+                }
+            }
+            if (victim < 0)
+                return false;
+            Queue& other = queues[victim];
+            std::lock_guard<std::mutex> lock(other.mutex);
+            if (!other.jobs.empty()) {
+                job = other.jobs.back();
+                other.jobs.pop_back();
+                return true;
+            }
+        }
+    }
+};
+
+/**
+ * Reads the scalars of an OMNeT++ .sca file into columns named
+ * <module>.<name>. Quoted names are unquoted.
+ */
+bool readScalars(const std::string& path, std::map<std::string, std::string>& scalars)
+{
+    FILE *f = fopen(path.c_str(), "r");
+    if (!f)
+        return false;
+    char line[4096];
+    while (fgets(line, sizeof(line), f)) {
+        if (strncmp(line, "scalar ", 7) != 0)
+            continue;
+        std::vector<std::string> fields;
+        const char *p = line + 7;
+        while (*p && *p != '\n') {
+            while (*p == ' ' || *p == '\t')
+                p++;
+            if (!*p || *p == '\n')
+                break;
+            std::string field;
+            if (*p == '"') {
+                for (p++; *p && *p != '"'; p++) {
+                    if (*p == '\\' && p[1])
+                        p++;
+                    field += *p;
+                }
+                if (*p == '"')
+                    p++;
+            }
+            else {
+                while (*p && *p != ' ' && *p != '\t' && *p != '\n')
+                    field += *p++;
+            }
+            fields.push_back(field);
+        }
+        if (fields.size() >= 3)
+            scalars[fields[0] + "." + fields[1]] = fields[2];
+    }
+    fclose(f);
+    return true;
+}
+
+void usage()
+{
+    fprintf(stderr,
+            "usage: aqmsweep [options] -- <simulation command...>\n"
+            "  -p KEY=V1,V2,...   grid dimension: ini key and its values (repeatable)\n"
+            "  -o DIR             directory for the per-run files (default results)\n"
+            "  -s FILE            merged summary CSV (default DIR/summary.csv)\n"
+            "  -j N               parallel runs (default: number of cores)\n"
+            "  --vectors          keep vector recording on (default: off)\n"
+            "  -n                 print the commands without running them\n");
+    exit(2);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    Options opt;
+    int i = 1;
+    for (; i < argc; i++) {
+        std::string arg = argv[i];
+        auto next = [&]() -> const char * { if (i + 1 >= argc) usage(); return argv[++i]; };
+        if (arg == "--") {
+            i++;
+            break;
+        }
+        else if (arg == "-p") {
+            std::string assignment = next();
+            size_t eq = assignment.find('=');
+            if (eq == std::string::npos || eq == 0)
+                fail("invalid grid dimension '%s'", assignment.c_str());
+            Dimension dimension;
+            dimension.key = assignment.substr(0, eq);
+            dimension.values = split(assignment.substr(eq + 1), ',');
+            opt.dimensions.push_back(dimension);
+        }
+        else if (arg == "-o") opt.outputDir = next();
+        else if (arg == "-s") opt.summaryFile = next();
+        else if (arg == "-j") opt.jobs = atoi(next());
+        else if (arg == "--vectors") opt.vectors = true;
+        else if (arg == "-n") opt.dryRun = true;
+        else usage();
+    }
+    for (; i < argc; i++)
+        opt.command.push_back(argv[i]);
+    if (opt.command.empty())
+        usage();
+    if (opt.jobs <= 0)
+        opt.jobs = std::max(1u, std::thread::hardware_concurrency());
+    if (opt.summaryFile.empty())
+        opt.summaryFile = opt.outputDir + "/summary.csv";
+    if (!fileExists(opt.outputDir) && mkdir(opt.outputDir.c_str(), 0777) != 0)
+        fail("cannot create '%s'", opt.outputDir.c_str());
+
+    std::string baseCommand;
+    for (auto& word : opt.command)
+        baseCommand += shellQuote(word) + " ";
+
+    std::vector<Run> runs = expand(opt.dimensions);
+    std::vector<int> status(runs.size(), 0);
+    size_t skipped = 0;
+    std::vector<size_t> pending;
+    for (size_t k = 0; k < runs.size(); k++) {
+        if (fileExists(opt.outputDir + "/" + runs[k].name + ".sca"))
+            skipped++;
+        else
+            pending.push_back(k);
+    }
+    fprintf(stderr, "aqmsweep: %zu runs, %zu already done, %zu to run on %d workers\n", runs.size(), skipped,
+            pending.size(), opt.jobs);
+
+    JobQueues queues(opt.jobs, pending.size());
+    std::mutex logMutex;
+    auto worker = [&](int id) {
+        size_t job;
+        while (queues.take(id, job)) {
+            const Run& run = runs[pending[job]];
+            std::string prefix = opt.outputDir + "/" + run.name;
+            std::string cmd = baseCommand;
+            for (size_t d = 0; d < opt.dimensions.size(); d++)
+                cmd += shellQuote("--" + opt.dimensions[d].key + "=" + run.values[d]) + " ";
+            cmd += shellQuote("--output-scalar-file=" + prefix + ".sca.tmp") + " ";
+            cmd += shellQuote("--output-vector-file=" + prefix + ".vec") + " ";
+            if (!opt.vectors)
+                cmd += shellQuote("--**.vector-recording=false") + " "; // per-object option: needs the object pattern
+            cmd += "--cmdenv-express-mode=true ";
+            cmd += "> " + shellQuote(prefix + ".log") + " 2>&1";
+            if (opt.dryRun) {
+                std::lock_guard<std::mutex> lock(logMutex);
+                printf("%s\n", cmd.c_str());
+                continue;
+            }
+            int rc = runCommand(cmd);
+            if (rc == 0 && rename((prefix + ".sca.tmp").c_str(), (prefix + ".sca").c_str()) != 0)
+                rc = -1;
+            status[pending[job]] = rc;
+            std::lock_guard<std::mutex> lock(logMutex);
+            fprintf(stderr, "aqmsweep: %s %s\n", run.name.c_str(), rc == 0 ? "done" : "FAILED, see .log");
+        }
+    };
+    std::vector<std::thread> threads;
+    for (int w = 1; w < opt.jobs; w++)
+        threads.emplace_back(worker, w);
+    worker(0);
+    for (auto& thread : threads)
+        thread.join();
+    if (opt.dryRun)
+        return 0;
+
+    // merge: the column set is the union over all runs
+    std::vector<std::map<std::string, std::string>> scalars(runs.size());
+    std::map<std::string, int> columns;
+    size_t failed = 0;
+    for (size_t k = 0; k < runs.size(); k++) {
+        if (status[k] != 0 || !readScalars(opt.outputDir + "/" + runs[k].name + ".sca", scalars[k])) {
+            failed++;
+            continue;
+        }
+        for (auto& entry : scalars[k])
+            columns[entry.first] = 0;
+    }
+    FILE *f = fopen(opt.summaryFile.c_str(), "w");
+    if (!f)
+        fail("cannot open '%s'", opt.summaryFile.c_str());
+    fprintf(f, "run");
+    for (auto& dimension : opt.dimensions)
+        fprintf(f, ",%s", csvField(dimension.key).c_str());
+    for (auto& column : columns)
+        fprintf(f, ",%s", csvField(column.first).c_str());
+    fprintf(f, "\n");
+    for (size_t k = 0; k < runs.size(); k++) {
+        fprintf(f, "%s", runs[k].name.c_str());
+        for (auto& value : runs[k].values)
+            fprintf(f, ",%s", csvField(value).c_str());
+        for (auto& column : columns) {
+            auto it = scalars[k].find(column.first);
+            fprintf(f, ",%s", it != scalars[k].end() ? csvField(it->second).c_str() : "");
+        }
+        fprintf(f, "\n");
+    }
+    fclose(f);
+    fprintf(stderr, "aqmsweep: %zu columns, %zu failed runs, summary in %s\n", columns.size(), failed,
+            opt.summaryFile.c_str());
+    return failed > 0 ? 1 : 0;
+}
+
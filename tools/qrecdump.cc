@@ -0,0 +1,304 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+//
+// qrecdump: reads the binary result files of BinaryResultRecorder.
+//
+//   qrecdump --list results/General-0.qrec
+//   qrecdump --from 10s --to 10.5s --name queueLength results/General-0.qrec
+//
+// Writes the records as CSV (time,module,name,value) to stdout, optionally
+// restricted to a time window and to the streams whose module path or
+// result name contain the given strings. The window start is found by a
+// binary search over the fixed-size blocks, so only the blocks that
+// overlap the window are read. --list prints the stream table instead.
+//
+// A file left behind by a crashed run has no stream table; its records are
+// still dumped, with the stream id in place of module and name.
+//
+// Build: g++ -O2 -std=c++11 -I<inet>/src tools/qrecdump.cc -o qrecdump
+//
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "inet/common/queue/BinaryResultFormat.h"
+
+using namespace inet::binrec;
+
+namespace {
+
+typedef int64_t ticks_t;
+
+int scaleExp = -12;
+
+[[noreturn]] void fail(const char *fmt, const char *arg = "")
+{
+    fprintf(stderr, "qrecdump: ");
+    fprintf(stderr, fmt, arg);
+    fprintf(stderr, "\n");
+    exit(1);
+}
+
+/**
+ * Parses "12.5ms" style times into ticks without going through double,
+ * like aqmreplay does.
+ */
+ticks_t parseTime(const char *s)
+{
+    const char *p = s;
+    bool negative = *p == '-';
+    if (*p == '-' || *p == '+')
+        p++;
+    int64_t mantissa = 0;
+    int exp = 0;
+    bool any = false;
+    for (; *p >= '0' && *p <= '9'; p++, any = true)
+        mantissa = mantissa * 10 + (*p - '0');
+    if (*p == '.') {
+        for (p++; *p >= '0' && *p <= '9'; p++, any = true) {
+            if (mantissa < INT64_MAX / 100) {
+                mantissa = mantissa * 10 + (*p - '0');
+                exp--;
+            }
+        }
+    }
+    if (!any)
+        fail("invalid time value '%s'", s);
+    if (p[0] == 's' && !isalpha(p[1]))
+        p++;
+    else if (p[0] == 'm' && p[1] == 's')
+        exp -= 3, p += 2;
+    else if (p[0] == 'u' && p[1] == 's')
+        exp -= 6, p += 2;
+    else if (p[0] == 'n' && p[1] == 's')
+        exp -= 9, p += 2;
+    else if (p[0] == 'p' && p[1] == 's')
+        exp -= 12, p += 2;
+    if (*p)
+        fail("invalid time value '%s'", s);
+    exp -= scaleExp;
+    for (; exp > 0; exp--)
+        mantissa *= 10;
+    for (; exp < 0; exp++)
+        mantissa /= 10;
+    return negative ? -mantissa : mantissa;
+}
+
+std::string formatTime(ticks_t t)
+{
+    int64_t scale = 1;
+    for (int i = 0; i < -scaleExp; i++)
+        scale *= 10;
+    std::string sign = t < 0 ? "-" : "";
+    if (t < 0)
+        t = -t;
+    std::string fraction = std::to_string(t % scale);
+    fraction.insert(0, -scaleExp - fraction.size(), '0');
+    return sign + std::to_string(t / scale) + "." + fraction;
+}
+
+struct Stream
+{
+    std::string module;
+    std::string name;
+};
+
+class Reader
+{
+  public:
+    FILE *file = nullptr;
+    FileHeader header;
+    std::vector<Stream> streams;
+    int64_t numBlocks = 0;
+
+  public:
+    explicit Reader(const char *fileName);
+    ~Reader() { fclose(file); }
+    ticks_t blockStartTime(int64_t k);
+    bool readBlock(int64_t k, std::vector<char>& block);
+    int64_t findBlock(ticks_t t);
+};
+
+Reader::Reader(const char *fileName)
+{
+    file = fopen(fileName, "rb");
+    if (!file)
+        fail("cannot open '%s'", fileName);
+    if (fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.magic, FILE_MAGIC, sizeof(header.magic)) != 0)
+        fail("'%s' is not a binary result file", fileName);
+    if (header.version < 1 || header.version > VERSION)
+        fail("unsupported binary result file version in '%s'", fileName);
+    if (header.blockSize < sizeof(BlockHeader) + sizeof(Record))
+        fail("invalid block size in '%s'", fileName);
+    scaleExp = header.scaleExp;
+
+    int64_t end = header.streamTableOffset;
+    if (end == 0) {
+        fprintf(stderr, "qrecdump: '%s' has no stream table, the run did not finish\n", fileName);
+        fseeko(file, 0, SEEK_END);
+        end = ftello(file);
+    }
+    numBlocks = (end - (int64_t)sizeof(header)) / header.blockSize;
+
+    if (header.streamTableOffset != 0) {
+        fseeko(file, header.streamTableOffset, SEEK_SET);
+        streams.resize(header.numStreams);
+        for (uint32_t i = 0; i < header.numStreams; i++) {
+            uint16_t entry[3];
+            if (fread(entry, sizeof(entry), 1, file) != 1 || entry[0] >= header.numStreams)
+                fail("truncated stream table in '%s'", fileName);
+            Stream& stream = streams[entry[0]];
+            stream.module.resize(entry[1]);
+            stream.name.resize(entry[2]);
+            if ((entry[1] && fread(&stream.module[0], entry[1], 1, file) != 1)
+                || (entry[2] && fread(&stream.name[0], entry[2], 1, file) != 1))
+                fail("truncated stream table in '%s'", fileName);
+        }
+    }
+}
+
+ticks_t Reader::blockStartTime(int64_t k)
+{
+    BlockHeader blockHeader;
+    fseeko(file, sizeof(header) + k * header.blockSize, SEEK_SET);
+    if (fread(&blockHeader, sizeof(blockHeader), 1, file) != 1 || blockHeader.magic != BLOCK_MAGIC)
+        fail("corrupt block header");
+    return blockHeader.startTime;
+}
+
+bool Reader::readBlock(int64_t k, std::vector<char>& block)
+{
+    block.resize(header.blockSize);
+    fseeko(file, sizeof(header) + k * header.blockSize, SEEK_SET);
+    if (fread(block.data(), header.blockSize, 1, file) != 1)
+        return false;
+    const BlockHeader *blockHeader = reinterpret_cast<const BlockHeader *>(block.data());
+    if (blockHeader->magic != BLOCK_MAGIC || blockHeader->count > (header.blockSize - sizeof(BlockHeader)) / sizeof(Record))
+        fail("corrupt block header");
+    return true;
+}
+
+/**
+ * The last block starting before t, i.e. the first one that can hold
+ * records at t, even if the blocks after it start exactly at t.
+ */
+int64_t Reader::findBlock(ticks_t t)
+{
+    int64_t lo = 0, hi = numBlocks;
+    while (hi - lo > 1) {
+        int64_t mid = lo + (hi - lo) / 2;
+        if (blockStartTime(mid) < t)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+void usage()
+{
+    fprintf(stderr,
+            "usage: qrecdump [options] <file.qrec>\n"
+            "  --list               print the stream table and exit\n"
+            "  --from TIME          first time to dump (default: start of the file)\n"
+            "  --to TIME            last time to dump (default: end of the file)\n"
+            "  --module STRING      only streams whose module path contains STRING\n"
+            "  --name STRING        only streams whose result name contains STRING\n"
+            "  --no-header          omit the CSV header line\n");
+    exit(2);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    bool list = false, csvHeader = true;
+    const char *from = nullptr, *to = nullptr, *fileName = nullptr;
+    std::string moduleFilter, nameFilter;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto next = [&]() -> const char * { if (i + 1 >= argc) usage(); return argv[++i]; };
+        if (arg == "--list") list = true;
+        else if (arg == "--from") from = next();
+        else if (arg == "--to") to = next();
+        else if (arg == "--module") moduleFilter = next();
+        else if (arg == "--name") nameFilter = next();
+        else if (arg == "--no-header") csvHeader = false;
+        else if (arg[0] == '-' || fileName) usage();
+        else fileName = argv[i];
+    }
+    if (!fileName)
+        usage();
+
+    Reader reader(fileName);
+    if (list) {
+        printf("stream,module,name\n");
+        for (size_t i = 0; i < reader.streams.size(); i++)
+            printf("%zu,%s,%s\n", i, reader.streams[i].module.c_str(), reader.streams[i].name.c_str());
+        return 0;
+    }
+
+    // times are parsed after the header, which gives the tick scale
+    ticks_t fromTime = from ? parseTime(from) : INT64_MIN;
+    ticks_t toTime = to ? parseTime(to) : INT64_MAX;
+
+    std::vector<char> selected(std::max<size_t>(reader.streams.size(), UINT16_MAX + 1), 1);
+    if (!moduleFilter.empty() || !nameFilter.empty()) {
+        if (reader.streams.empty())
+            fail("--module and --name need the stream table");
+        for (size_t i = 0; i < reader.streams.size(); i++)
+            selected[i] = reader.streams[i].module.find(moduleFilter) != std::string::npos
+                && reader.streams[i].name.find(nameFilter) != std::string::npos;
+        for (size_t i = reader.streams.size(); i < selected.size(); i++)
+            selected[i] = 0;
+    }
+
+    if (csvHeader)
+        printf("time,module,name,value\n");
+    std::vector<char> block;
+    for (int64_t k = from ? reader.findBlock(fromTime) : 0; k < reader.numBlocks && reader.readBlock(k, block); k++) {
+        const BlockHeader *blockHeader = reinterpret_cast<const BlockHeader *>(block.data());
+        const Record *records = reinterpret_cast<const Record *>(block.data() + sizeof(BlockHeader));
+        if (blockHeader->startTime > toTime)
+            break;
+        ticks_t t = blockHeader->startTime;
+        for (uint32_t i = 0; i < blockHeader->count; i++) {
+            const Record& record = records[i];
+            if (record.flags & TIME_RECORD) {
+                t = getAbsoluteTime(record);
+                continue;
+            }
+            t += record.delta;
+            if (t > toTime)
+                break;
+            if (t < fromTime || !selected[record.stream])
+                continue;
+            if (record.stream < reader.streams.size()) {
+                const Stream& stream = reader.streams[record.stream];
+                printf("%s,%s,%s,%.17g\n", formatTime(t).c_str(), stream.module.c_str(), stream.name.c_str(), record.value);
+            }
+            else
+                printf("%s,%u,,%.17g\n", formatTime(t).c_str(), record.stream, record.value);
+        }
+    }
+    return 0;
+}